@@ -0,0 +1,84 @@
+#include "extension.h"
+#include "breakable_queue.h"
+#include "resolve_collision_tools.h"
+#include "takedamageinfohack.h"
+
+BreakableQueue g_breakableQueue;
+BreakableQueue* breakablequeue = &g_breakableQueue;
+
+BreakableQueue::BreakableQueue() :
+	m_stats()
+{
+}
+
+bool BreakableQueue::Push(CBaseEntity* breakable, CBaseEntity* attacker, const Vector& motion, const Vector& position)
+{
+	const CBaseHandle& handle = ((IHandleEntity*)breakable)->GetRefEHandle();
+	const int index = handle.GetEntryIndex();
+
+	if (index < 0 || index >= MAX_EDICTS)
+		return false;
+
+	if (m_pending[index] == handle)
+	{
+		m_stats.deduplicated++;
+		return m_attacker[index] == ((IHandleEntity*)attacker)->GetRefEHandle();
+	}
+
+	int entry = m_entries.AddToTail();
+	m_entries[entry].breakable = handle;
+	m_entries[entry].attacker = ((IHandleEntity*)attacker)->GetRefEHandle();
+	m_entries[entry].motion = motion;
+	m_entries[entry].position = position;
+
+	m_pending[index] = handle;
+	m_attacker[index] = m_entries[entry].attacker;
+	m_stats.queued++;
+	return true;
+}
+
+bool BreakableQueue::IsPending(const IHandleEntity* entity, const CBaseEntity* attacker) const
+{
+	if (m_entries.Count() == 0)
+		return false;
+
+	const CBaseHandle& handle = entity->GetRefEHandle();
+	const int index = handle.GetEntryIndex();
+
+	return index >= 0 && index < MAX_EDICTS && m_pending[index] == handle && m_attacker[index] == ((const IHandleEntity*)attacker)->GetRefEHandle();
+}
+
+void BreakableQueue::Flush()
+{
+	FOR_EACH_VEC(m_entries, it)
+	{
+		const Entry& entry = m_entries[it];
+
+		m_pending[entry.breakable.GetEntryIndex()].Term();
+
+		CBaseEntity* breakable = collisiontools->BaseHandleToBaseEntity(entry.breakable);
+		CBaseEntity* attacker = collisiontools->BaseHandleToBaseEntity(entry.attacker);
+
+		// broken by something else or its attacker is gone
+		if (breakable == nullptr || attacker == nullptr)
+			continue;
+
+		CTakeDamageInfoHack damageInfo(attacker, attacker, 100.0f, DMG_CRUSH, nullptr, vec3_origin, vec3_origin);
+		collisiontools->CalculateExplosiveDamageForce(&damageInfo, entry.motion, entry.position);
+		collisiontools->TakeDamage(breakable, damageInfo);
+
+		m_stats.broken++;
+	}
+
+	m_entries.RemoveAll();
+}
+
+void BreakableQueue::Clear()
+{
+	FOR_EACH_VEC(m_entries, it)
+	{
+		m_pending[m_entries[it].breakable.GetEntryIndex()].Term();
+	}
+
+	m_entries.RemoveAll();
+}
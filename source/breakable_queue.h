@@ -0,0 +1,59 @@
+#ifndef _INCLUDE_BREAKABLE_QUEUE_H
+#define _INCLUDE_BREAKABLE_QUEUE_H
+
+#include <mathlib/vector.h>
+#include <basehandle.h>
+#include <utlvector.h>
+#include <const.h>
+
+class CBaseEntity;
+class IHandleEntity;
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Flimsy breakables commons walked into this frame, damaged once each from the next game frame.
+ * Until then they are pending and collision traces of the bot that walked into them pass through them, the rest of the
+ * horde still collides with them like with any unbroken breakable.
+ */
+class BreakableQueue
+{
+public:
+	struct Stats
+	{
+		int queued;
+		int deduplicated;		// hits on a breakable already pending
+		int broken;				// damage applied
+	};
+
+	BreakableQueue();
+
+	// queue damage by attacker moving along motion, once per breakable and frame.
+	// False if it's already pending for another bot, it stays solid to this one until it breaks
+	bool Push(CBaseEntity* breakable, CBaseEntity* attacker, const Vector& motion, const Vector& position);
+	bool IsPending(const IHandleEntity* entity, const CBaseEntity* attacker) const;
+
+	// apply the queued damage, the first bot to reach a breakable deals it
+	void Flush();
+	void Clear();
+
+	const Stats& GetStats() const { return m_stats; }
+	void ResetStats() { m_stats = Stats(); }
+
+private:
+	struct Entry
+	{
+		CBaseHandle breakable;
+		CBaseHandle attacker;
+		Vector motion;
+		Vector position;
+	};
+
+	CUtlVector<Entry> m_entries;
+	CBaseHandle m_pending[MAX_EDICTS];		// handle of the pending breakable in its entity index
+	CBaseHandle m_attacker[MAX_EDICTS];		// the bot it's pending for, in the breakable's entity index
+	Stats m_stats;
+};
+
+extern BreakableQueue* breakablequeue;
+
+#endif // !_INCLUDE_BREAKABLE_QUEUE_H
@@ -0,0 +1,120 @@
+#include "extension.h"
+#include "contact_pairs.h"
+#include "resolve_collision_tools.h"
+
+#include <string.h>
+#include <limits.h>
+
+ContactPairs g_contactPairs;
+ContactPairs* contactpairs = &g_contactPairs;
+
+ContactPairs::ContactPairs() :
+	m_count(0),
+	m_frame(0),
+	m_stats()
+{
+	memset(m_slots, 0, sizeof(m_slots));
+}
+
+void ContactPairs::Clear()
+{
+	memset(m_slots, 0, sizeof(m_slots));
+	m_count = 0;
+}
+
+void ContactPairs::NewFrame()
+{
+	m_frame++;
+
+	if ((m_frame % CONTACT_PERSIST_FRAMES) == 0)
+		Compact();
+}
+
+void ContactPairs::Compact()
+{
+	memcpy(m_scratch, m_slots, sizeof(m_slots));
+	memset(m_slots, 0, sizeof(m_slots));
+
+	const int count = m_count;
+	m_count = 0;
+
+	for (int i = 0; i < CAPACITY; i++)
+	{
+		const Slot& slot = m_scratch[i];
+
+		if (slot.key == 0)
+			continue;
+
+		if (m_frame - slot.frame > CONTACT_PERSIST_FRAMES)
+			continue;
+
+		Slot* moved = Find(slot.key, true);
+		moved->frame = slot.frame;
+	}
+
+	m_stats.end += count - m_count;
+}
+
+ContactPairs::Slot* ContactPairs::Find(uint32_t key, bool insert)
+{
+	for (uint32_t i = HashKey(key), probe = 0; probe < CAPACITY; i = (i + 1) & (CAPACITY - 1), probe++)
+	{
+		Slot& slot = m_slots[i];
+
+		if (slot.key == key)
+			return &slot;
+
+		if (slot.key == 0)
+		{
+			if (!insert)
+				return nullptr;
+
+			slot.key = key;
+			slot.frame = INT_MIN;
+			m_count++;
+			return &slot;
+		}
+	}
+
+	return nullptr;
+}
+
+ContactState ContactPairs::Mark(CBaseEntity* entity, CBaseEntity* other, ContactChannel channel)
+{
+	const uint32_t first = collisiontools->GetEntityIndex(entity);
+	const uint32_t second = collisiontools->GetEntityIndex(other);
+
+	// 0 is reserved for empty slots
+	const uint32_t key = ((((uint32_t)channel << 12) | first) << 12 | second) + 1;
+
+	// keep probing short, drop stale pairs early when getting full
+	if (m_count >= CAPACITY * 3 / 4)
+		Compact();
+
+	Slot* slot = Find(key, m_count < CAPACITY * 3 / 4);
+
+	// full of live pairs, behave as if every contact is new
+	if (slot == nullptr)
+	{
+		m_stats.begin++;
+		return CONTACT_BEGIN;
+	}
+
+	const int last = slot->frame;
+	slot->frame = m_frame;
+
+	if (last == m_frame)
+	{
+		m_stats.repeat++;
+		return CONTACT_REPEAT;
+	}
+
+	if (last != INT_MIN && m_frame - last <= CONTACT_PERSIST_FRAMES)
+	{
+		m_stats.persist++;
+		return CONTACT_PERSIST;
+	}
+
+	m_stats.begin++;
+	return CONTACT_BEGIN;
+}
@@ -0,0 +1,75 @@
+#ifndef _INCLUDE_CONTACT_PAIRS_H
+#define _INCLUDE_CONTACT_PAIRS_H
+
+#include <stdint.h>
+
+class CBaseEntity;
+
+enum ContactChannel
+{
+	CONTACT_LOCOMOTION = 0,			// DetectCollision hits, OnContact/Touch
+	CONTACT_INFECTED,				// infected-infected separation, Touch
+};
+
+enum ContactState
+{
+	CONTACT_BEGIN = 0,				// first seen in this frame
+	CONTACT_PERSIST,				// seen recently, first time in this frame
+	CONTACT_REPEAT,					// already seen in this frame
+};
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Set of directed entity pairs in contact, keyed by entity indices and stamped with the frame they were last seen.
+ * A pair ends when it isn't seen for CONTACT_PERSIST_FRAMES, bots don't update every frame so it has to outlive one.
+ */
+class ContactPairs
+{
+public:
+	static constexpr int CAPACITY_BITS = 14;
+	static constexpr int CAPACITY = 1 << CAPACITY_BITS;
+	static constexpr int CONTACT_PERSIST_FRAMES = 8;
+
+	struct Stats
+	{
+		int begin;
+		int persist;
+		int repeat;
+		int end;
+	};
+
+	ContactPairs();
+
+	void NewFrame();
+	void Clear();
+
+	ContactState Mark(CBaseEntity* entity, CBaseEntity* other, ContactChannel channel);
+
+	const Stats& GetStats() const { return m_stats; }
+	void ResetStats() { m_stats = Stats(); }
+
+private:
+	struct Slot
+	{
+		uint32_t key;				// 0 when empty
+		int frame;
+	};
+
+	static inline uint32_t HashKey(uint32_t key)
+	{
+		return (key * 2654435761u) >> (32 - CAPACITY_BITS);
+	}
+
+	void Compact();
+	Slot* Find(uint32_t key, bool insert);
+
+	Slot m_slots[CAPACITY];
+	Slot m_scratch[CAPACITY];
+	int m_count;
+	int m_frame;
+	Stats m_stats;
+};
+
+extern ContactPairs* contactpairs;
+
+#endif // !_INCLUDE_CONTACT_PAIRS_H
@@ -0,0 +1,77 @@
+#ifndef _INCLUDE_ENTITY_SLOTS_H
+#define _INCLUDE_ENTITY_SLOTS_H
+
+#include <const.h>
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Base of every entity-index-addressed storage.
+ * Instances link themselves into a global list so the entity listener can release
+ * a slot in all of them at once when an entity is destroyed.
+ */
+class IEntitySlotStorage
+{
+public:
+	IEntitySlotStorage()
+	{
+		m_next = s_head;
+		s_head = this;
+	}
+
+	virtual void Release(int index) = 0;
+	virtual void ReleaseAll() = 0;
+
+	static void ReleaseSlot(int index)
+	{
+		for (IEntitySlotStorage* storage = s_head; storage; storage = storage->m_next)
+			storage->Release(index);
+	}
+
+	static void ReleaseAllSlots()
+	{
+		for (IEntitySlotStorage* storage = s_head; storage; storage = storage->m_next)
+			storage->ReleaseAll();
+	}
+
+private:
+	IEntitySlotStorage* m_next;
+	static inline IEntitySlotStorage* s_head = nullptr;
+};
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Fixed-capacity array of T addressed by entity index.
+ * Released slots are reset to a default constructed T.
+ */
+template<typename T, int N = MAX_EDICTS>
+class CEntitySlotStorage : public IEntitySlotStorage
+{
+public:
+	inline T& operator[](int index)
+	{
+		Assert(IsValidIndex(index));
+		return m_slots[index];
+	}
+
+	inline bool IsValidIndex(int index) const
+	{
+		return index >= 0 && index < N;
+	}
+
+	virtual void Release(int index) override
+	{
+		if (IsValidIndex(index))
+			m_slots[index] = T();
+	}
+
+	virtual void ReleaseAll() override
+	{
+		for (int i = 0; i < N; i++)
+			m_slots[i] = T();
+	}
+
+private:
+	T m_slots[N];
+};
+
+#endif // !_INCLUDE_ENTITY_SLOTS_H
@@ -4,6 +4,14 @@
 #include <compat_wrappers.h>
 #include "resolve_collision.h"
 #include "resolve_collision_tools.h"
+#include "entity_slots.h"
+#include "infected_grid.h"
+#include "contact_pairs.h"
+#include "trace_cache.h"
+#include "mover_tracker.h"
+#include "ground_heightfield.h"
+#include "ledge_table.h"
+#include "breakable_queue.h"
 
 SDKResolveCollision g_sdkResolveCollision;
 SMEXT_LINK(&g_sdkResolveCollision);
@@ -16,6 +24,7 @@ IEngineTrace* enginetrace = nullptr;
 IStaticPropMgrServer* staticpropmgr = nullptr;
 CDebugOverlay* debugoverlay = nullptr;
 ISDKHooks* g_pSDKHooks = nullptr;
+ISpatialPartition* partition = nullptr;
 
 CDetour* g_pResolveCollisionDetour = nullptr;
 CDetour* g_pResolveZombieCollisionDetour = nullptr;
@@ -25,70 +34,245 @@ CDetour* g_pUpdatePosition = nullptr;
 
 ConVar z_resolve_collision("z_resolve_collision", "1", 0, "0 - Use original function; 1 - Use extension implementation with fix; 2 - Use extension implementation without fix; 3 - Neither of calls");
 ConVar z_resolve_collision_debug("z_resolve_collision_debug", "0", 0, "0 - Disable collision overlay;1 - Enable collision overlay; 2 - Enable clean collision overlay (works only for 1 common but smoother)");
-
-ConVar z_resolve_zombie_collision("z_resolve_zombie_collision", "1", 0, "0 - Use original function; 1 - Use extension implementation");
+ConVar z_resolve_collision_contact_once("z_resolve_collision_contact_once", "1", 0, "0 - Invoke OnContact/Touch on every collision; 1 - Invoke OnContact/Touch at most once per colliding pair per frame");
+ConVar z_resolve_collision_trace_cache("z_resolve_collision_trace_cache", "0", 0, "0 - Disable; 1 - Share ground traces of nearby bots within a frame, recomputing the hit for each bot's own start against the shared plane");
+ConVar z_resolve_collision_split_trace("z_resolve_collision_split_trace", "1", 0, "0 - Trace world and entities together; 1 - Trace world first and entities only if any overlaps the swept bounds");
+ConVar z_resolve_collision_native_filter("z_resolve_collision_native_filter", "0", 0, "0 - Use game's trace filter callbacks; 1 - Use extension reimplementation reading cached entity data");
+ConVar z_resolve_collision_traversable_cache("z_resolve_collision_traversable_cache", "1", 0, "0 - Ask IsEntityTraversable on every filtered entity; 1 - Share commons' IsEntityTraversable verdicts within a tick");
+ConVar z_resolve_collision_ground_reuse("z_resolve_collision_ground_reuse", "1", 0, "0 - Trace the ground every update; 1 - Reuse the last world ground while the bot barely moves and no mover changed nearby");
+ConVar z_resolve_collision_ground_reuse_distance("z_resolve_collision_ground_reuse_distance", "1.0", 0, "Maximum distance a bot may move from where its ground was traced for the result to be reused", true, 0.0f, false, 0.0f);
+ConVar z_resolve_collision_ground_heightfield_budget("z_resolve_collision_ground_heightfield_budget", "2", 0, "Heightfield cells sampled per frame at most, lookups of unsampled cells past it trace the ground instead", true, 0.0f, false, 0.0f);
+ConVar z_resolve_collision_ground_heightfield("z_resolve_collision_ground_heightfield", "0", 0, "0 - Disable; 1 - Snap to world ground planes sampled lazily into a per-map grid, tracing only where it isn't a single plane");
+ConVar z_resolve_collision_solver("z_resolve_collision_solver", "0", 0, "0 - Slide along the last plane hit and trace again like the game; 1 - Clip the rest of the move against every plane hit during it and stop once nothing is left");
+ConVar z_resolve_collision_contact_plane("z_resolve_collision_contact_plane", "0", 0, "0 - Rediscover walls with a sweep on every move; 1 - Slide along the wall hit on the previous moves first and confirm with a short sweep that it still backs the slide");
+ConVar z_resolve_collision_depenetrate("z_resolve_collision_depenetrate", "1", 0, "0 - Return to the last valid position when starting inside solid; 1 - Probe along the horizontal axes, out of the plane we're stuck in first, for the nearest spot out of solid reachable from the last valid position first (not for doors), backing off on bots that stay stuck");
+ConVar z_resolve_collision_ignore_props("z_resolve_collision_ignore_props", "1", 0, "0 - Ignore only the last moving physics prop a common got stuck in like the game; 1 - Ignore every one of them for its own second, up to 6 per common");
+ConVar z_resolve_collision_breakable_queue("z_resolve_collision_breakable_queue", "1", 0, "0 - Break flimsy breakables and retrace as soon as a common hits them; 1 - Let the common that hit one pass through it and break it once at the start of the next frame");
+ConVar z_resolve_collision_sleep_ticks("z_resolve_collision_sleep_ticks", "0", 0, "Ticks a common has to stand still on the world before its collision and ground updates are skipped until it's disturbed; 0 - Never sleep", true, 0.0f, false, 0.0f);
+
+ConVar z_resolve_zombie_collision("z_resolve_zombie_collision", "1", 0, "0 - Use original function; 1 - Use extension implementation; 2 - Use extension implementation with contacting pairs solved once per frame");
 ConVar z_resolve_zombie_collision_multiplier("z_resolve_zombie_collision_multiplier", "1.0", 0, "Multiplier of commons collision force");
 
 ConVar z_resolve_zombie_climb_up_ledge("z_resolve_zombie_climb_up_ledge", "1", 0, "0 - Use original function; 1 - Use extension implementation");
+ConVar z_resolve_zombie_climb_up_ledge_bisect("z_resolve_zombie_climb_up_ledge_bisect", "1", 0, "0 - Step through ledge offsets one by one like the game; 1 - Try offsets predicted from the wall plane and bisect the rest");
+ConVar z_resolve_zombie_climb_up_ledge_fail_time("z_resolve_zombie_climb_up_ledge_fail_time", "0.5", 0, "Seconds a common refuses to retry a ledge climb that found no wall from the same spot without tracing; 0 - Always trace", true, 0.0f, false, 0.0f);
+ConVar z_resolve_zombie_climb_up_ledge_table("z_resolve_zombie_climb_up_ledge_table", "0", 0, "0 - Search every ledge with traces; 1 - Remember the landing spot of climbed ledges for the map and only validate it on the next climb");
 ConVar z_resolve_zombie_climb_up_ledge_debug("z_resolve_zombie_climb_up_ledge_debug", "0", 0, "0 - Disable debug; 1 - Enable debug");
 
 ConVar z_resolve_zombie_collision_auto_multiplier("z_resolve_zombie_collision_auto_multiplier", "1", 0, "Automaticly manages power of collision between common infected");
+ConVar z_resolve_zombie_climb_push_distance("z_resolve_zombie_climb_push_distance", "50.0");
 
-DETOUR_DECL_MEMBER1(NextBotGroundLocomotion__ResolveZombieCollisions, Vector, const Vector&, pos)
+ConVar z_resolve_zombie_collision_neighbors("z_resolve_zombie_collision_neighbors", "1", 0, "0 - Use game's Infected::m_vecNeighbors; 1 - Use extension spatial hash of infected rebuilt every frame");
+ConVar z_resolve_zombie_collision_max_neighbors("z_resolve_zombie_collision_max_neighbors", "0", 0, "Maximum number of nearest neighbors pushing a common, works only with z_resolve_zombie_collision_neighbors 1; 0 - No limit");
+ConVar z_resolve_zombie_collision_touch("z_resolve_zombie_collision_touch", "0", 0, "0 - Touch contacting commons every frame; 1 - Touch contacting commons only when the contact begins");
+
+bool g_bLateLoad = false;
+
+ResolveCollisionSettings g_settings;
+
+static void RefreshSettings()
 {
-	NextBotGroundLocomotion* groundLocomotion = (NextBotGroundLocomotion*)this;
+	static ConVar* nb_stop = nullptr;
+	static ConVar* nb_gravity = nullptr;
+
+	if (nb_stop == nullptr)
+		nb_stop = icvar->FindVar("nb_stop");
+
+	if (nb_gravity == nullptr)
+		nb_gravity = icvar->FindVar("nb_gravity");
+
+	g_settings.resolve_collision = z_resolve_collision.GetInt();
+	g_settings.resolve_collision_debug = z_resolve_collision_debug.GetInt();
+	g_settings.resolve_collision_solver = z_resolve_collision_solver.GetInt();
+	g_settings.resolve_zombie_collision = z_resolve_zombie_collision.GetInt();
+	g_settings.zombie_collision_neighbors = z_resolve_zombie_collision_neighbors.GetInt();
+	g_settings.zombie_collision_max_neighbors = z_resolve_zombie_collision_max_neighbors.GetInt();
+	g_settings.zombie_collision_touch = z_resolve_zombie_collision_touch.GetInt();
+	g_settings.sleep_ticks = z_resolve_collision_sleep_ticks.GetInt();
+	g_settings.ground_heightfield_budget = z_resolve_collision_ground_heightfield_budget.GetInt();
+
+	g_settings.zombie_collision_multiplier = z_resolve_zombie_collision_multiplier.GetFloat();
+	g_settings.zombie_climb_push_distance = z_resolve_zombie_climb_push_distance.GetFloat();
+	g_settings.ground_reuse_distance = z_resolve_collision_ground_reuse_distance.GetFloat();
+	g_settings.zombie_climb_fail_time = z_resolve_zombie_climb_up_ledge_fail_time.GetFloat();
+	g_settings.nb_gravity = nb_gravity ? nb_gravity->GetFloat() : 1000.0f;
+
+	g_settings.collision_contact_once = z_resolve_collision_contact_once.GetBool();
+	g_settings.trace_cache = z_resolve_collision_trace_cache.GetBool();
+	g_settings.collision_split_trace = z_resolve_collision_split_trace.GetBool();
+	g_settings.native_trace_filter = z_resolve_collision_native_filter.GetBool();
+	g_settings.traversable_cache = z_resolve_collision_traversable_cache.GetBool();
+	g_settings.ground_reuse = z_resolve_collision_ground_reuse.GetBool();
+	g_settings.ground_heightfield = z_resolve_collision_ground_heightfield.GetBool();
+	g_settings.contact_plane = z_resolve_collision_contact_plane.GetBool();
+	g_settings.depenetrate = z_resolve_collision_depenetrate.GetBool();
+	g_settings.ignore_props = z_resolve_collision_ignore_props.GetBool();
+	g_settings.breakable_queue = z_resolve_collision_breakable_queue.GetBool();
+	g_settings.zombie_collision_auto_multiplier = z_resolve_zombie_collision_auto_multiplier.GetBool();
+	g_settings.zombie_climb_up_ledge = z_resolve_zombie_climb_up_ledge.GetBool();
+	g_settings.zombie_climb_up_ledge_debug = z_resolve_zombie_climb_up_ledge_debug.GetBool();
+	g_settings.zombie_climb_up_ledge_bisect = z_resolve_zombie_climb_up_ledge_bisect.GetBool();
+	g_settings.zombie_climb_ledge_table = z_resolve_zombie_climb_up_ledge_table.GetBool();
+	g_settings.nb_stop = nb_stop ? nb_stop->GetBool() : false;
+
+	SelectResolveCollision();
+}
+
+// Features that are turned off don't keep their detour, so the original function runs without any overhead
+static void UpdateDetours()
+{
+	auto toggle = [](CDetour* detour, bool enable)
+		{
+			if (detour == nullptr)
+				return;
+
+			if (enable)
+				detour->EnableDetour();
+			else
+				detour->DisableDetour();
+		};
 
-	if (z_resolve_zombie_collision.GetInt() == 1)
-		return groundLocomotion->ResolveZombieCollisions(pos);
+	toggle(g_pResolveCollisionDetour, g_settings.resolve_collision != 0);
+	toggle(g_pUpdatePosition, g_settings.resolve_collision != 0);
+	toggle(g_pResolveZombieCollisionDetour, g_settings.resolve_zombie_collision != 0);
+	toggle(g_pResolveZombieClimbUpLedgeDetour, g_settings.zombie_climb_up_ledge);
 
-	return DETOUR_MEMBER_CALL(NextBotGroundLocomotion__ResolveZombieCollisions)(pos);
+	// the ground shortcuts only live in our UpdateGroundConstraint, not just the ledge climb fix
+	toggle(g_pUpdateGroundConstraint, g_settings.zombie_climb_up_ledge || g_settings.ground_reuse || g_settings.ground_heightfield ||
+		g_settings.sleep_ticks > 0 || g_settings.trace_cache);
+}
+
+static void OnSettingsChanged(IConVar* var, const char* pOldValue, float flOldValue)
+{
+	const char* name = var->GetName();
+
+	if (strncmp(name, "z_resolve_", 10) == 0 || strcmp(name, "nb_stop") == 0 || strcmp(name, "nb_gravity") == 0)
+	{
+		RefreshSettings();
+		UpdateDetours();
+	}
+}
+
+DETOUR_DECL_MEMBER1(NextBotGroundLocomotion__ResolveZombieCollisions, Vector, const Vector&, pos)
+{
+	NextBotGroundLocomotion* groundLocomotion = (NextBotGroundLocomotion*)this;
+	return groundLocomotion->ResolveZombieCollisions(pos);
 }
 
 DETOUR_DECL_MEMBER3(NextBotGroundLocomotion__ResolveCollision, Vector, const Vector&, from, const Vector&, to, int, recursionLimit)
 {
 	NextBotGroundLocomotion* groundLocomotion = (NextBotGroundLocomotion*)this;
 	
-	if (z_resolve_collision.GetInt() == 3)
+	if (g_settings.resolve_collision == 3)
 		return to;
 
-	if (z_resolve_collision.GetBool())
-		return groundLocomotion->ResolveCollision(from, to, recursionLimit);
-
-	return DETOUR_MEMBER_CALL(NextBotGroundLocomotion__ResolveCollision)(from, to, recursionLimit);
+	return groundLocomotion->ResolveCollision(from, to, recursionLimit);
 }
 
 DETOUR_DECL_MEMBER3(NextBotGroundLocomotion__ClimbUpToLedge, bool, const Vector&, landingGoal, const Vector&, landingForward, const CBaseEntity*, obstacle)
 {
 	NextBotGroundLocomotion* groundLocomotion = (NextBotGroundLocomotion*)this;
-
-	if (z_resolve_zombie_climb_up_ledge.GetBool())
-		return groundLocomotion->ClimbUpToLedgeThunk(landingGoal, landingForward, obstacle);
-
-	return DETOUR_MEMBER_CALL(NextBotGroundLocomotion__ClimbUpToLedge)(landingGoal, landingForward, obstacle);
+	return groundLocomotion->ClimbUpToLedgeThunk(landingGoal, landingForward, obstacle);
 }
 
 DETOUR_DECL_MEMBER0(ZombieBotLocomotion__UpdateGroundConstraint, void)
 {
 	NextBotGroundLocomotion* groundLocomotion = (NextBotGroundLocomotion*)this;
-
-	if (z_resolve_zombie_climb_up_ledge.GetBool())
-		return groundLocomotion->UpdateGroundConstraint();
-
-	DETOUR_MEMBER_CALL(ZombieBotLocomotion__UpdateGroundConstraint)();
+	groundLocomotion->UpdateGroundConstraint();
 }
 
 DETOUR_DECL_MEMBER1(ZombieBotLocomotion__UpdatePosition, void, const Vector&, newPos)
 {
 	NextBotGroundLocomotion* groundLocomotion = (NextBotGroundLocomotion*)this;
+	groundLocomotion->UpdatePosition(newPos);
+}
 
-	if (z_resolve_collision.GetBool())
-		return groundLocomotion->UpdatePosition(newPos);
+CON_COMMAND(z_resolve_collision_stats, "Print counters of the extension caches; pass reset to zero them")
+{
+	if (args.ArgC() > 1 && strcmp(args.Arg(1), "reset") == 0)
+	{
+		contactpairs->ResetStats();
+		tracecache->ResetStats();
+		groundheightfield->ResetStats();
+		ledgetable->ResetStats();
+		breakablequeue->ResetStats();
+		infectedgrid->ResetStats();
+		g_resolveCollisionStats = ResolveCollisionStats();
+		return;
+	}
+
+	auto percent = [](int part, int total) -> float
+		{
+			return total > 0 ? 100.0f * part / total : 0.0f;
+		};
 
-	DETOUR_MEMBER_CALL(ZombieBotLocomotion__UpdatePosition)(newPos);
+	const ContactPairs::Stats& contacts = contactpairs->GetStats();
+	const TraceCache::Stats& traces = tracecache->GetStats();
+
+	META_CONPRINTF("Contact pairs: %d begin, %d persist, %d repeat suppressed, %d end\n", contacts.begin, contacts.persist, contacts.repeat, contacts.end);
+	META_CONPRINTF("DetectCollision: %d world only, %d with entities\n", g_resolveCollisionStats.detect_world_only, g_resolveCollisionStats.detect_entity);
+	META_CONPRINTF("Traversable cache: %d lookups, %d hits (%.1f%%)\n", g_resolveCollisionStats.traversable_lookups, g_resolveCollisionStats.traversable_hits, percent(g_resolveCollisionStats.traversable_hits, g_resolveCollisionStats.traversable_lookups));
+	const GroundHeightfield::Stats& heightfield = groundheightfield->GetStats();
+
+	META_CONPRINTF("Ground: %d traced, %d reused, %d from heightfield\n", g_resolveCollisionStats.ground_traces, g_resolveCollisionStats.ground_reused,
+		g_resolveCollisionStats.ground_heightfield);
+	for (int solver = 0; solver < 2; solver++)
+	{
+		const int resolves = g_resolveCollisionStats.resolves[solver];
+		const int sweeps = g_resolveCollisionStats.resolve_sweeps[solver];
+
+		META_CONPRINTF("ResolveCollision (%s): %d calls, %d sweeps (%.2f per call), %d hit the recursion limit\n", solver ? "multi-plane" : "single plane",
+			resolves, sweeps, resolves > 0 ? (float)sweeps / resolves : 0.0f, g_resolveCollisionStats.resolve_limits[solver]);
+	}
+
+	META_CONPRINTF("Stuck: %d startsolid sweeps, %d depenetrated (%d probes), %d bots stuck, %d moves skipped while backing off\n", g_resolveCollisionStats.startsolid_sweeps,
+		g_resolveCollisionStats.depenetrations, g_resolveCollisionStats.depenetration_probes, g_resolveCollisionStats.stuck_bots, g_resolveCollisionStats.stuck_skips);
+	META_CONPRINTF("Contact plane: %d hits, %d misses (%.1f%%)\n", g_resolveCollisionStats.contact_plane_hits, g_resolveCollisionStats.contact_plane_misses,
+		percent(g_resolveCollisionStats.contact_plane_hits, g_resolveCollisionStats.contact_plane_hits + g_resolveCollisionStats.contact_plane_misses));
+	META_CONPRINTF("Climb: %d climbs, %d traces (%.1f per climb), %d refused from failed climbs\n", g_resolveCollisionStats.climbs, g_resolveCollisionStats.climb_traces,
+		g_resolveCollisionStats.climbs > 0 ? (float)g_resolveCollisionStats.climb_traces / g_resolveCollisionStats.climbs : 0.0f, g_resolveCollisionStats.climb_fail_hits);
+	const LedgeTable::Stats& ledges = ledgetable->GetStats();
+
+	META_CONPRINTF("Ledge table: %d ledges, %d lookups, %d hits (%.1f%%), %d rejected by validation\n", ledgetable->GetCount(), ledges.lookups, ledges.hits,
+		percent(ledges.hits, ledges.lookups), ledges.rejected);
+	META_CONPRINTF("Sleep: %d sleeps, %d wakes, %d updates skipped\n", g_resolveCollisionStats.sleeps, g_resolveCollisionStats.wakes, g_resolveCollisionStats.sleeping_updates);
+	META_CONPRINTF("Heightfield: %d cells (%d sampled), %.1f KiB, %d lookups, %d hits (%.1f%%), %d deferred past the budget\n", groundheightfield->GetCellCount(), heightfield.samples,
+		groundheightfield->GetMemoryUsage() / 1024.0f, heightfield.lookups, heightfield.hits, percent(heightfield.hits, heightfield.lookups), heightfield.deferred);
+	const InfectedGrid::Stats& grid = infectedgrid->GetStats();
+
+	META_CONPRINTF("Infected grid: %d gathers, %d too crowded and left to the neighbor list\n", grid.gathers, grid.truncated);
+	const BreakableQueue::Stats& breakables = breakablequeue->GetStats();
+
+	META_CONPRINTF("Breakables: %d queued, %d repeated hits merged, %d broken\n", breakables.queued, breakables.deduplicated, breakables.broken);
+	META_CONPRINTF("Trace cache: %d lookups, %d hits (%.1f%%)\n", traces.lookups, traces.hits, percent(traces.hits, traces.lookups));
+}
+
+static void OnGameFrame(bool simulating)
+{
+	if (!simulating)
+		return;
+
+	breakablequeue->Flush();
+	contactpairs->NewFrame();
+	tracecache->NewFrame();
+	groundheightfield->NewFrame();
+	movertracker->Update();
+
+	if (g_settings.resolve_zombie_collision == 2)
+	{
+		infectedgrid->Rebuild();
+		infectedgrid->SolveSeparation();
+	}
+	else if (g_settings.resolve_zombie_collision == 1 && g_settings.zombie_collision_neighbors == 1)
+	{
+		infectedgrid->Rebuild();
+	}
 }
 
 bool SDKResolveCollision::SDK_OnLoad(char* error, size_t maxlen, bool late)
 {
+	g_bLateLoad = late;
+
 	if (!gameconfs->LoadGameConfigFile("l4d2_resolve_collision", &gpConfig, error, maxlen))
 		return false;
 
@@ -98,6 +282,11 @@ bool SDKResolveCollision::SDK_OnLoad(char* error, size_t maxlen, bool late)
 		return false;
 	}
 
+	sharesys->AddDependency(myself, "sdkhooks.ext", true, true);
+
+	RefreshSettings();
+	icvar->InstallGlobalChangeCallback(OnSettingsChanged);
+
 	CDetourManager::Init(g_pSM->GetScriptingEngine(), gpConfig);
 
 	g_pResolveCollisionDetour = DETOUR_CREATE_MEMBER(NextBotGroundLocomotion__ResolveCollision, "NextBotGroundLocomotion::ResolveCollision");
@@ -141,20 +330,31 @@ bool SDKResolveCollision::SDK_OnLoad(char* error, size_t maxlen, bool late)
 	}
 #endif
 
-	g_pUpdateGroundConstraint->EnableDetour();
-	g_pResolveCollisionDetour->EnableDetour();
-	g_pResolveZombieCollisionDetour->EnableDetour();
-	g_pResolveZombieClimbUpLedgeDetour->EnableDetour();
+	UpdateDetours();
 
-#ifdef _WIN32
-	g_pUpdatePosition->EnableDetour();
-#endif
+	smutils->AddGameFrameHook(OnGameFrame);
 
 	return true;
 }
 
 void SDKResolveCollision::SDK_OnAllLoaded()
 {
+	SM_GET_LATE_IFACE(SDKHOOKS, g_pSDKHooks);
+
+	if (g_pSDKHooks)
+		g_pSDKHooks->AddEntityListener(this);
+
+	// entities created before we were loaded were never reported to the listener
+	if (g_bLateLoad)
+	{
+		for (int i = 0; i < MAX_EDICTS; i++)
+		{
+			CBaseEntity* entity = gamehelpers->ReferenceToEntity(i);
+
+			if (entity)
+				OnEntityCreated(entity, gamehelpers->GetEntityClassname(entity));
+		}
+	}
 }
 
 bool SDKResolveCollision::SDK_OnMetamodLoad(ISmmAPI* ismm, char* error, size_t maxlen, bool late)
@@ -167,6 +367,9 @@ bool SDKResolveCollision::SDK_OnMetamodLoad(ISmmAPI* ismm, char* error, size_t m
 	GET_V_IFACE_ANY(GetEngineFactory, enginetrace, IEngineTrace, INTERFACEVERSION_ENGINETRACE_SERVER);
 	GET_V_IFACE_CURRENT(GetEngineFactory, icvar, ICvar, CVAR_INTERFACE_VERSION);
 	GET_V_IFACE_CURRENT(GetPhysicsFactory, iphysics, IPhysics, VPHYSICS_INTERFACE_VERSION);
+
+	// optional, DetectCollision traces world and entities together without it
+	partition = (ISpatialPartition*)ismm->VInterfaceMatch(ismm->GetEngineFactory(), INTERFACEVERSION_SPATIALPARTITION, 0);
 	g_pCVar = icvar;
 	CONVAR_REGISTER(this);
 	gpGlobals = ismm->GetCGlobals();
@@ -194,13 +397,85 @@ void SDKResolveCollision::SDK_OnUnload()
 	safe_release(g_pResolveZombieCollisionDetour);
 	safe_release(g_pResolveZombieClimbUpLedgeDetour);
 	safe_release(g_pUpdatePosition);
+
+	smutils->RemoveGameFrameHook(OnGameFrame);
+
+	icvar->RemoveGlobalChangeCallback(OnSettingsChanged);
+
+	if (g_pSDKHooks)
+	{
+		g_pSDKHooks->RemoveEntityListener(this);
+		g_pSDKHooks = nullptr;
+	}
+
+	IEntitySlotStorage::ReleaseAllSlots();
+	infectedgrid->Clear();
+	contactpairs->Clear();
+	tracecache->Clear();
+	movertracker->Clear();
+	groundheightfield->Clear();
+	ledgetable->Clear();
+	breakablequeue->Clear();
+}
+
+void SDKResolveCollision::OnCoreMapEnd()
+{
+	infectedgrid->Clear();
+	contactpairs->Clear();
+	tracecache->Clear();
+	movertracker->Clear();
+	groundheightfield->Clear();
+	ledgetable->Clear();
+	breakablequeue->Clear();
 }
 
 bool SDKResolveCollision::QueryRunning(char* error, size_t maxlength)
 {
+	SM_CHECK_IFACE(SDKHOOKS, g_pSDKHooks);
 	return true;
 }
 
+bool SDKResolveCollision::QueryInterfaceDrop(SMInterface* pInterface)
+{
+	if (pInterface == g_pSDKHooks)
+		return false;
+
+	return IExtensionInterface::QueryInterfaceDrop(pInterface);
+}
+
+void SDKResolveCollision::NotifyInterfaceDrop(SMInterface* pInterface)
+{
+	if (strcmp(pInterface->GetInterfaceName(), SMINTERFACE_SDKHOOKS_NAME) == 0)
+	{
+		g_pSDKHooks->RemoveEntityListener(this);
+		g_pSDKHooks = nullptr;
+	}
+}
+
+void SDKResolveCollision::OnEntityCreated(CBaseEntity* pEntity, const char* classname)
+{
+	if (pEntity == nullptr)
+		return;
+
+	int flags = collisiontools->ClassifyEntity(pEntity, classname);
+
+	if (flags & ENTITY_INFECTED)
+		infectedgrid->Track(pEntity);
+
+	if (flags & ENTITY_MOVER)
+		movertracker->Track(pEntity);
+}
+
+void SDKResolveCollision::OnEntityDestroyed(CBaseEntity* pEntity)
+{
+	if (pEntity == nullptr)
+		return;
+
+	infectedgrid->Untrack(pEntity);
+	movertracker->Untrack(pEntity);
+	IEntitySlotStorage::ReleaseSlot(collisiontools->GetEntityIndex(pEntity));
+}
+
 bool SDKResolveCollision::RegisterConCommandBase(ConCommandBase* command)
 {
 	return META_REGCVAR(command);
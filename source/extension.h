@@ -40,6 +40,7 @@
 #include <vphysics_interface.h>
 #include <IEngineTrace.h>
 #include <IStaticPropMgr.h>
+#include <ispatialpartition.h>
 #include "debugoverlay.h"
 
 #undef clamp
@@ -59,6 +60,9 @@ public: // SDKExtension
 	virtual void SDK_OnAllLoaded() override;
 	// virtual void SDK_OnPauseChange(bool paused) override;
 	virtual bool QueryRunning(char* error, size_t maxlen) override;
+	virtual void OnCoreMapEnd() override;
+	virtual bool QueryInterfaceDrop(SMInterface* pInterface) override;
+	virtual void NotifyInterfaceDrop(SMInterface* pInterface) override;
 
 public: // SDKExtension MetaMod
 #if defined SMEXT_CONF_METAMOD
@@ -69,6 +73,10 @@ public: // SDKExtension MetaMod
 
 public: // IConCommandBaseAccessor
 	virtual bool RegisterConCommandBase(ConCommandBase* command) override;
+
+public: // ISMEntityListener
+	virtual void OnEntityCreated(CBaseEntity* pEntity, const char* classname) override;
+	virtual void OnEntityDestroyed(CBaseEntity* pEntity) override;
 };
 
 extern SDKResolveCollision g_sdkResolveCollision;
@@ -78,15 +86,86 @@ extern IEngineTrace* enginetrace;
 extern IStaticPropMgrServer* staticpropmgr;
 extern IPhysics* iphysics;
 extern CDebugOverlay* debugoverlay;
+extern ISDKHooks* g_pSDKHooks;
+extern ISpatialPartition* partition;
 
 extern ConVar z_resolve_collision;
 extern ConVar z_resolve_collision_debug;
+extern ConVar z_resolve_collision_contact_once;
+extern ConVar z_resolve_collision_trace_cache;
+extern ConVar z_resolve_collision_split_trace;
+extern ConVar z_resolve_collision_native_filter;
+extern ConVar z_resolve_collision_traversable_cache;
+extern ConVar z_resolve_collision_ground_reuse;
+extern ConVar z_resolve_collision_ground_reuse_distance;
+extern ConVar z_resolve_collision_ground_heightfield;
+extern ConVar z_resolve_collision_sleep_ticks;
+extern ConVar z_resolve_collision_ground_heightfield_budget;
+extern ConVar z_resolve_collision_solver;
+extern ConVar z_resolve_collision_contact_plane;
+extern ConVar z_resolve_collision_depenetrate;
+extern ConVar z_resolve_collision_ignore_props;
+extern ConVar z_resolve_collision_breakable_queue;
 
 extern ConVar z_resolve_zombie_collision;
 extern ConVar z_resolve_zombie_collision_multiplier;
+extern ConVar z_resolve_zombie_collision_auto_multiplier;
+extern ConVar z_resolve_zombie_collision_neighbors;
+extern ConVar z_resolve_zombie_collision_max_neighbors;
+extern ConVar z_resolve_zombie_collision_touch;
 
 extern ConVar z_resolve_zombie_climb_up_ledge;
 extern ConVar z_resolve_zombie_climb_up_ledge_debug;
+extern ConVar z_resolve_zombie_climb_up_ledge_bisect;
+extern ConVar z_resolve_zombie_climb_up_ledge_fail_time;
+extern ConVar z_resolve_zombie_climb_up_ledge_table;
 extern ConVar z_resolve_zombie_climb_up_slope_timer;
+extern ConVar z_resolve_zombie_climb_push_distance;
+
+/**
+ * @brief Plain copy of every tunable read on the hot path.
+ * Refreshed only from ConVar change callbacks, so readers never go through ConVar accessors.
+ */
+struct alignas(64) ResolveCollisionSettings
+{
+	int resolve_collision;						// z_resolve_collision
+	int resolve_collision_debug;				// z_resolve_collision_debug
+	int resolve_collision_solver;				// z_resolve_collision_solver
+	int resolve_zombie_collision;				// z_resolve_zombie_collision
+	int zombie_collision_neighbors;				// z_resolve_zombie_collision_neighbors
+	int zombie_collision_max_neighbors;			// z_resolve_zombie_collision_max_neighbors
+	int zombie_collision_touch;					// z_resolve_zombie_collision_touch
+	int sleep_ticks;							// z_resolve_collision_sleep_ticks
+	int ground_heightfield_budget;				// z_resolve_collision_ground_heightfield_budget
+
+	float zombie_collision_multiplier;			// z_resolve_zombie_collision_multiplier
+	float zombie_climb_push_distance;			// z_resolve_zombie_climb_push_distance
+	float ground_reuse_distance;				// z_resolve_collision_ground_reuse_distance
+	float zombie_climb_fail_time;				// z_resolve_zombie_climb_up_ledge_fail_time
+	float nb_gravity;							// nb_gravity, 1000 if the game doesn't have it
+
+	// flags are packed so the whole snapshot stays on one cache line
+	bool collision_contact_once : 1;			// z_resolve_collision_contact_once
+	bool trace_cache : 1;						// z_resolve_collision_trace_cache
+	bool collision_split_trace : 1;				// z_resolve_collision_split_trace
+	bool native_trace_filter : 1;				// z_resolve_collision_native_filter
+	bool traversable_cache : 1;					// z_resolve_collision_traversable_cache
+	bool ground_reuse : 1;						// z_resolve_collision_ground_reuse
+	bool ground_heightfield : 1;				// z_resolve_collision_ground_heightfield
+	bool contact_plane : 1;						// z_resolve_collision_contact_plane
+	bool depenetrate : 1;						// z_resolve_collision_depenetrate
+	bool ignore_props : 1;						// z_resolve_collision_ignore_props
+	bool breakable_queue : 1;					// z_resolve_collision_breakable_queue
+	bool zombie_collision_auto_multiplier : 1;	// z_resolve_zombie_collision_auto_multiplier
+	bool zombie_climb_up_ledge : 1;				// z_resolve_zombie_climb_up_ledge
+	bool zombie_climb_up_ledge_debug : 1;		// z_resolve_zombie_climb_up_ledge_debug
+	bool zombie_climb_up_ledge_bisect : 1;		// z_resolve_zombie_climb_up_ledge_bisect
+	bool zombie_climb_ledge_table : 1;			// z_resolve_zombie_climb_up_ledge_table
+	bool nb_stop : 1;							// nb_stop
+};
+
+static_assert(sizeof(ResolveCollisionSettings) <= 64, "ResolveCollisionSettings must fit a single cache line");
+
+extern ResolveCollisionSettings g_settings;
 
 #endif // _INCLUDE_SOURCEMOD_EXTENSION_PROPER_H_
@@ -0,0 +1,186 @@
+#include "extension.h"
+#include "ground_heightfield.h"
+
+GroundHeightfield g_groundHeightfield;
+GroundHeightfield* groundheightfield = &g_groundHeightfield;
+
+GroundHeightfield::GroundHeightfield() :
+	m_count(0),
+	m_sampled(0),
+	m_stats()
+{
+}
+
+void GroundHeightfield::Clear()
+{
+	m_cells.Purge();
+	m_count = 0;
+}
+
+GroundHeightfield::Cell* GroundHeightfield::Find(uint64_t key)
+{
+	// keep at most half full so probing stays short and always ends on an empty slot
+	if (m_count * 2 >= m_cells.Count() && m_count < MAX_CELLS)
+		Grow();
+
+	const uint32_t mask = m_cells.Count() - 1;
+
+	for (uint32_t i = HashKey(key) & mask;; i = (i + 1) & mask)
+	{
+		Cell& cell = m_cells[i];
+
+		if (cell.key == key && cell.state != CELL_EMPTY)
+			return &cell;
+
+		if (cell.state == CELL_EMPTY)
+			return m_count < MAX_CELLS ? &cell : nullptr;
+	}
+}
+
+void GroundHeightfield::Grow()
+{
+	CUtlVector<Cell> old;
+	old.Swap(m_cells);
+
+	m_cells.SetCount(old.Count() ? old.Count() * 2 : 4096);
+
+	FOR_EACH_VEC(m_cells, it)
+		m_cells[it].state = CELL_EMPTY;
+
+	const uint32_t mask = m_cells.Count() - 1;
+
+	FOR_EACH_VEC(old, it)
+	{
+		if (old[it].state == CELL_EMPTY)
+			continue;
+
+		uint32_t i = HashKey(old[it].key) & mask;
+
+		while (m_cells[i].state != CELL_EMPTY)
+			i = (i + 1) & mask;
+
+		m_cells[i] = old[it];
+	}
+}
+
+void GroundHeightfield::Sample(Cell& cell, int x, int y, int z, unsigned int mask)
+{
+	m_stats.samples++;
+
+	cell.state = CELL_MIXED;
+	cell.mask = mask;
+
+	// rays cover every height a bot standing in this band can find ground at
+	const float top = (z + 1) * Z_BAND + 20.0f;
+	const float bottom = z * Z_BAND - 20.0f;
+
+	const float minX = x * CELL_SIZE - SAMPLE_MARGIN;
+	const float minY = y * CELL_SIZE - SAMPLE_MARGIN;
+
+	CTraceFilterWorldOnly filter;
+	Vector normal;
+	float dist = 0.0f;
+
+	// rays closer than a hull is wide, so no pit or step a bot could stand in or on falls between them
+	for (int i = 0; i < SAMPLE_COUNT; i++)
+	{
+		for (int j = 0; j < SAMPLE_COUNT; j++)
+		{
+			const float sx = minX + i * SAMPLE_SPACING;
+			const float sy = minY + j * SAMPLE_SPACING;
+
+			Ray_t ray;
+			trace_t trace;
+
+			ray.Init(Vector(sx, sy, top), Vector(sx, sy, bottom));
+			enginetrace->TraceRay(ray, mask, &filter, &trace);
+
+			if (trace.startsolid || trace.fraction >= 1.0f || trace.plane.normal.z <= 0.0f)
+				return;
+
+			if (i == 0 && j == 0)
+			{
+				normal = trace.plane.normal;
+				dist = trace.plane.dist;
+				continue;
+			}
+
+			// every sample has to lie on the first one's plane
+			if (DotProduct(normal, trace.plane.normal) < 0.999f || fabsf(DotProduct(normal, trace.endpos) - dist) > 0.1f)
+				return;
+		}
+	}
+
+	// rays slip past anything thinner than their spacing, boxes between them have to come to rest on the plane too
+	const float half = SAMPLE_SPACING * 0.5f;
+	const Vector mins(-half, -half, 0.0f);
+	const Vector maxs(half, half, 1.0f);
+
+	for (int i = 0; i < SAMPLE_COUNT - 1; i++)
+	{
+		for (int j = 0; j < SAMPLE_COUNT - 1; j++)
+		{
+			const float cx = minX + i * SAMPLE_SPACING + half;
+			const float cy = minY + j * SAMPLE_SPACING + half;
+
+			// a box resting on a plane touches it with its highest bottom corner
+			const float height = (dist - normal.x * cx - normal.y * cy + (fabsf(normal.x) + fabsf(normal.y)) * half) / normal.z;
+
+			Ray_t ray;
+			trace_t trace;
+
+			ray.Init(Vector(cx, cy, top), Vector(cx, cy, bottom), mins, maxs);
+			enginetrace->TraceRay(ray, mask, &filter, &trace);
+
+			if (trace.startsolid || trace.fraction >= 1.0f || fabsf(trace.endpos.z - height) > 0.25f)
+				return;
+		}
+	}
+
+	cell.state = CELL_UNIFORM;
+	cell.normal = normal;
+	cell.dist = dist;
+}
+
+bool GroundHeightfield::GetPlane(const Vector& pos, float halfWidth, unsigned int mask, Vector& normal, float& dist)
+{
+	m_stats.lookups++;
+
+	if (halfWidth > SAMPLE_MARGIN)
+		return false;
+
+	const int x = CellCoord(pos.x, CELL_SIZE);
+	const int y = CellCoord(pos.y, CELL_SIZE);
+	const int z = CellCoord(pos.z, Z_BAND);
+	const uint64_t key = MakeKey(x, y, z);
+
+	Cell* cell = Find(key);
+
+	if (cell == nullptr)
+		return false;
+
+	if (cell->state == CELL_EMPTY)
+	{
+		// the cell stays empty for a later frame, this lookup traces for itself
+		if (m_sampled >= g_settings.ground_heightfield_budget)
+		{
+			m_stats.deferred++;
+			return false;
+		}
+
+		m_sampled++;
+		cell->key = key;
+		m_count++;
+
+		Sample(*cell, x, y, z, mask);
+	}
+
+	if (cell->state != CELL_UNIFORM || cell->mask != mask)
+		return false;
+
+	normal = cell->normal;
+	dist = cell->dist;
+
+	m_stats.hits++;
+	return true;
+}
@@ -0,0 +1,94 @@
+#ifndef _INCLUDE_GROUND_HEIGHTFIELD_H
+#define _INCLUDE_GROUND_HEIGHTFIELD_H
+
+#include <mathlib/vector.h>
+#include <utlvector.h>
+#include <stdint.h>
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Sparse per-map grid of world ground planes, filled lazily from world-only traces.
+ * A cell spans CELL_SIZE in XY and Z_BAND in height, it is uniform when every ray SAMPLE_SPACING apart under its
+ * region plus SAMPLE_MARGIN hits the same plane and boxes swept down between the rays all come to rest on it.
+ * Entities and static props aren't part of it, callers have to check them.
+ */
+class GroundHeightfield
+{
+public:
+	static constexpr float CELL_SIZE = 16.0f;
+	static constexpr float Z_BAND = 32.0f;
+	static constexpr float SAMPLE_MARGIN = 24.0f;		// widest hull half width a cell answers for
+	static constexpr float SAMPLE_SPACING = 16.0f;		// below the narrowest hull width
+	static constexpr int SAMPLE_COUNT = (int)((CELL_SIZE + 2.0f * SAMPLE_MARGIN) / SAMPLE_SPACING) + 1;	// samples per axis
+	static constexpr int MAX_CELLS = 1 << 18;
+
+	struct Stats
+	{
+		int lookups;
+		int hits;
+		int samples;				// cells sampled
+		int deferred;				// lookups of unsampled cells after the frame's budget was spent
+	};
+
+	GroundHeightfield();
+
+	void NewFrame() { m_sampled = 0; }
+	void Clear();
+
+	// world plane under a hull of halfWidth at pos, false if the cell isn't a single plane or wasn't sampled yet.
+	// Sampling a cell costs 25 rays and 16 box sweeps inline, at most z_resolve_collision_ground_heightfield_budget
+	// cells are sampled per frame
+	bool GetPlane(const Vector& pos, float halfWidth, unsigned int mask, Vector& normal, float& dist);
+
+	size_t GetMemoryUsage() const { return m_cells.Count() * sizeof(Cell); }
+	int GetCellCount() const { return m_count; }
+
+	const Stats& GetStats() const { return m_stats; }
+	void ResetStats() { m_stats = Stats(); }
+
+private:
+	enum CellState : uint8_t
+	{
+		CELL_EMPTY = 0,
+		CELL_UNIFORM,
+		CELL_MIXED,
+	};
+
+	struct Cell
+	{
+		uint64_t key;
+		Vector normal;
+		float dist;
+		unsigned int mask;
+		CellState state;
+	};
+
+	static inline int CellCoord(float value, float size)
+	{
+		return (int)floorf(value / size);
+	}
+
+	static inline uint64_t MakeKey(int x, int y, int z)
+	{
+		// 21 bits per axis, offset to stay positive
+		return ((uint64_t)(x + (1 << 20)) << 42) | ((uint64_t)(y + (1 << 20)) << 21) | (uint64_t)(z + (1 << 20));
+	}
+
+	static inline uint32_t HashKey(uint64_t key)
+	{
+		return (uint32_t)((key * 0x9E3779B97F4A7C15ull) >> 32);
+	}
+
+	Cell* Find(uint64_t key);
+	void Grow();
+	void Sample(Cell& cell, int x, int y, int z, unsigned int mask);
+
+	CUtlVector<Cell> m_cells;		// open addressing, power of two
+	int m_count;
+	int m_sampled;					// cells sampled this frame
+	Stats m_stats;
+};
+
+extern GroundHeightfield* groundheightfield;
+
+#endif // !_INCLUDE_GROUND_HEIGHTFIELD_H
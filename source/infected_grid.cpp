@@ -0,0 +1,391 @@
+#include "extension.h"
+#include "infected_grid.h"
+#include "separation_kernel.h"
+#include "resolve_collision_tools.h"
+#include "util_shared.h"
+#include "NextBotGroundLocomotion.h"
+#include "NextBotInterface.h"
+#include "NextBotBodyInterface.h"
+
+InfectedGrid g_infectedGrid;
+InfectedGrid* infectedgrid = &g_infectedGrid;
+
+InfectedGrid::InfectedGrid() :
+	m_stats()
+{
+	for (int i = 0; i < MAX_EDICTS; i++)
+	{
+		m_trackedIndex[i] = -1;
+		m_entryIndex[i] = -1;
+		m_hullWidth[i] = 0.0f;
+		m_hullHeight[i] = 0.0f;
+	}
+
+	for (int i = 0; i < BUCKET_COUNT; i++)
+		m_buckets[i] = -1;
+}
+
+void InfectedGrid::Track(CBaseEntity* entity)
+{
+	int index = collisiontools->GetEntityIndex(entity);
+
+	if (index < 0 || index >= MAX_EDICTS || m_trackedIndex[index] != -1)
+		return;
+
+	m_trackedIndex[index] = m_tracked.AddToTail(entity);
+	m_hullWidth[index] = 0.0f;
+}
+
+void InfectedGrid::Untrack(CBaseEntity* entity)
+{
+	int index = collisiontools->GetEntityIndex(entity);
+
+	if (index < 0 || index >= MAX_EDICTS || m_trackedIndex[index] == -1)
+		return;
+
+	// swap the last one into the freed position
+	int position = m_trackedIndex[index];
+	int last = m_tracked.Count() - 1;
+
+	if (position != last)
+	{
+		CBaseEntity* moved = m_tracked[last];
+		m_tracked[position] = moved;
+		m_trackedIndex[collisiontools->GetEntityIndex(moved)] = position;
+	}
+
+	m_tracked.Remove(last);
+	m_trackedIndex[index] = -1;
+
+	// the snapshot may still point at it until the next frame
+	if (m_entryIndex[index] != -1)
+	{
+		m_snapshot.entity[m_entryIndex[index]] = nullptr;
+		m_snapshot.flags[m_entryIndex[index]] = 0;
+		m_entryIndex[index] = -1;
+	}
+}
+
+void InfectedGrid::Clear()
+{
+	for (int i = 0; i < MAX_EDICTS; i++)
+	{
+		m_trackedIndex[i] = -1;
+		m_entryIndex[i] = -1;
+	}
+
+	for (int i = 0; i < BUCKET_COUNT; i++)
+		m_buckets[i] = -1;
+
+	m_tracked.RemoveAll();
+	m_snapshot.RemoveAll();
+	m_cellX.RemoveAll();
+	m_cellY.RemoveAll();
+	m_next.RemoveAll();
+	m_separation.RemoveAll();
+	m_contacts.RemoveAll();
+}
+
+void InfectedGrid::Rebuild()
+{
+	for (int i = 0; i < BUCKET_COUNT; i++)
+		m_buckets[i] = -1;
+
+	for (int i = 0; i < m_snapshot.Count(); i++)
+	{
+		if (m_snapshot.entity[i])
+			m_entryIndex[m_snapshot.index[i]] = -1;
+	}
+
+	const int count = m_tracked.Count();
+
+	m_snapshot.SetCount(count);
+	m_cellX.SetCount(count);
+	m_cellY.SetCount(count);
+	m_next.SetCount(count);
+	m_separation.RemoveAll();
+	m_contacts.RemoveAll();
+
+	int position = 0;
+
+	FOR_EACH_VEC(m_tracked, it)
+	{
+		CBaseEntity* entity = m_tracked[it];
+
+		if (!collisiontools->CBaseEntity_IsAlive(entity))
+			continue;
+
+		const Vector& origin = collisiontools->CBaseEntity_GetAbsOrigin(entity);
+		const int index = collisiontools->GetEntityIndex(entity);
+
+		m_snapshot.x[position] = origin.x;
+		m_snapshot.y[position] = origin.y;
+		m_snapshot.z[position] = origin.z;
+		m_snapshot.hullWidth[position] = GetHullWidth(entity, index);
+		m_snapshot.hullHeight[position] = m_hullHeight[index];
+		m_snapshot.flags[position] = SNAPSHOT_ALIVE;
+		m_snapshot.entity[position] = entity;
+		m_snapshot.index[position] = index;
+
+		m_cellX[position] = CellCoord(origin.x);
+		m_cellY[position] = CellCoord(origin.y);
+
+		int bucket = HashCell(m_cellX[position], m_cellY[position]);
+		m_next[position] = m_buckets[bucket];
+		m_buckets[bucket] = position;
+
+		m_entryIndex[index] = position;
+		position++;
+	}
+
+	m_snapshot.SetCount(position);
+	m_cellX.SetCount(position);
+	m_cellY.SetCount(position);
+	m_next.SetCount(position);
+}
+
+template<typename F>
+void InfectedGrid::ForEachInRange(const Vector& origin, float radius, float height, F&& callback) const
+{
+	const float x = origin.x;
+	const float y = origin.y;
+
+	const int minX = CellCoord(x - radius);
+	const int maxX = CellCoord(x + radius);
+	const int minY = CellCoord(y - radius);
+	const int maxY = CellCoord(y + radius);
+
+	for (int cellX = minX; cellX <= maxX; cellX++)
+	{
+		for (int cellY = minY; cellY <= maxY; cellY++)
+		{
+			for (int it = m_buckets[HashCell(cellX, cellY)]; it != -1; it = m_next[it])
+			{
+				// buckets are shared between cells on hash collision
+				if (m_cellX[it] != cellX || m_cellY[it] != cellY)
+					continue;
+
+				// cells are wider than the hull, anything outside the square around (x, y) can't be in contact
+				if (fabsf(m_snapshot.x[it] - x) >= radius || fabsf(m_snapshot.y[it] - y) >= radius)
+					continue;
+
+				// on another floor, stairs or catwalk, the game's neighbor list never pairs them either
+				if (fabsf(m_snapshot.z[it] - origin.z) >= height)
+					continue;
+
+				callback(it);
+			}
+		}
+	}
+}
+
+int InfectedGrid::GatherCandidates(const Vector& origin, float radius, float height, int first, const CBaseEntity* ignore, int* candidates, float* candX, float* candY) const
+{
+	int count = 0;
+
+	m_stats.gathers++;
+
+	ForEachInRange(origin, radius, height, [&](int it)
+		{
+			if (it <= first || (m_snapshot.flags[it] & SNAPSHOT_ALIVE) == 0 || m_snapshot.hullWidth[it] <= 0.0f || m_snapshot.entity[it] == ignore)
+				return;
+
+			// keep counting past the end so the caller can tell it's been cut short
+			if (count < MAX_CANDIDATES)
+			{
+				candidates[count] = it;
+				candX[count] = m_snapshot.x[it];
+				candY[count] = m_snapshot.y[it];
+			}
+
+			count++;
+		});
+
+	if (count > MAX_CANDIDATES)
+	{
+		m_stats.truncated++;
+		return -1;
+	}
+
+	return count;
+}
+
+int InfectedGrid::Separate(const Vector& origin, float hullWidth, float hullHeight, const CBaseEntity* ignore, int maxCount, Vector& avoid, float& avoidWeight, CBaseEntity** contacts) const
+{
+	int candidates[MAX_CANDIDATES];
+	float candX[MAX_CANDIDATES], candY[MAX_CANDIDATES];
+	float dirX[MAX_CANDIDATES], dirY[MAX_CANDIDATES], weight[MAX_CANDIDATES];
+	SeparationResult result;
+
+	int count = GatherCandidates(origin, hullWidth, hullHeight, -1, ignore, candidates, candX, candY);
+
+	if (count == -1)
+		return -1;
+
+	SeparationKernel(origin.x, origin.y, hullWidth, candX, candY, count, dirX, dirY, weight, result);
+
+	int contactCount = 0;
+
+	if (result.contacts <= maxCount)
+	{
+		avoid.Init(result.avoidX, result.avoidY, 0.0f);
+		avoidWeight = result.avoidWeight;
+
+		for (int i = 0; i < count; i++)
+		{
+			if (weight[i] > 0.0f)
+				contacts[contactCount++] = m_snapshot.entity[candidates[i]];
+		}
+
+		return contactCount;
+	}
+
+	// weight falls with range, so the nearest are the heaviest
+	avoid = vec3_origin;
+	avoidWeight = 0.0f;
+
+	for (; contactCount < maxCount; contactCount++)
+	{
+		int best = -1;
+
+		for (int i = 0; i < count; i++)
+		{
+			if (weight[i] > 0.0f && (best == -1 || weight[i] > weight[best]))
+				best = i;
+		}
+
+		avoid.x -= weight[best] * dirX[best];
+		avoid.y -= weight[best] * dirY[best];
+		avoidWeight += weight[best];
+
+		contacts[contactCount] = m_snapshot.entity[candidates[best]];
+		weight[best] = 0.0f;
+	}
+
+	return contactCount;
+}
+
+float InfectedGrid::GetHullWidth(CBaseEntity* entity, int index)
+{
+	if (m_hullWidth[index] > 0.0f)
+		return m_hullWidth[index];
+
+	INextBot* bot = collisiontools->MyNextBotPointer(entity);
+	IBody* body = bot ? bot->GetBodyInterface() : nullptr;
+
+	// not ready yet, try again next frame
+	if (body == nullptr)
+		return 0.0f;
+
+	m_hullWidth[index] = body->GetHullWidth();
+	m_hullHeight[index] = body->GetHullHeight();
+	return m_hullWidth[index];
+}
+
+void InfectedGrid::SolveSeparation()
+{
+	const int count = m_snapshot.Count();
+
+	m_separation.SetCount(count);
+
+	for (int i = 0; i < count; i++)
+	{
+		Separation& separation = m_separation[i];
+
+		separation.avoid = vec3_origin;
+		separation.avoidWeight = 0.0f;
+		separation.firstContact = -1;
+		separation.truncated = false;
+	}
+
+	int candidates[MAX_CANDIDATES];
+	float candX[MAX_CANDIDATES], candY[MAX_CANDIDATES];
+	float dirX[MAX_CANDIDATES], dirY[MAX_CANDIDATES], weight[MAX_CANDIDATES];
+	SeparationResult result;
+
+	for (int i = 0; i < count; i++)
+	{
+		const float hullWidth = m_snapshot.hullWidth[i];
+
+		if ((m_snapshot.flags[i] & SNAPSHOT_ALIVE) == 0 || hullWidth <= 0.0f)
+			continue;
+
+		const Vector origin(m_snapshot.x[i], m_snapshot.y[i], m_snapshot.z[i]);
+		const float hullHeight = m_snapshot.hullHeight[i];
+
+		// every pair is handled by its lower element only, commons share one hull so the lower one's is used for both,
+		// which also keeps commons a floor apart out of it
+		int candidateCount = GatherCandidates(origin, hullWidth, hullHeight, i, nullptr, candidates, candX, candY);
+
+		// too crowded to gather every pair, everyone who could be in contact here asks the neighbor list instead
+		if (candidateCount == -1)
+		{
+			m_separation[i].truncated = true;
+
+			ForEachInRange(origin, hullWidth, hullHeight, [&](int it)
+				{
+					m_separation[it].truncated = true;
+				});
+
+			continue;
+		}
+
+		SeparationKernel(m_snapshot.x[i], m_snapshot.y[i], hullWidth, candX, candY, candidateCount, dirX, dirY, weight, result);
+
+		if (result.contacts == 0)
+			continue;
+
+		Separation& mine = m_separation[i];
+
+		mine.avoid.x += result.avoidX;
+		mine.avoid.y += result.avoidY;
+		mine.avoidWeight += result.avoidWeight;
+
+		for (int it = 0; it < candidateCount; it++)
+		{
+			const int j = candidates[it];
+
+			if (weight[it] <= 0.0f)
+				continue;
+
+			// both sides get the same weight in opposite directions
+			Separation& theirs = m_separation[j];
+
+			theirs.avoid.x += weight[it] * dirX[it];
+			theirs.avoid.y += weight[it] * dirY[it];
+			theirs.avoidWeight += weight[it];
+
+			int contact = m_contacts.AddToTail();
+			m_contacts[contact].other = j;
+			m_contacts[contact].next = mine.firstContact;
+			mine.firstContact = contact;
+
+			contact = m_contacts.AddToTail();
+			m_contacts[contact].other = i;
+			m_contacts[contact].next = theirs.firstContact;
+			theirs.firstContact = contact;
+		}
+	}
+}
+
+int InfectedGrid::GetEntry(CBaseEntity* entity) const
+{
+	int index = collisiontools->GetEntityIndex(entity);
+
+	if (index < 0 || index >= MAX_EDICTS)
+		return -1;
+
+	return m_entryIndex[index];
+}
+
+bool InfectedGrid::GetSeparation(CBaseEntity* entity, Vector& avoid, float& avoidWeight) const
+{
+	int entry = GetEntry(entity);
+
+	if (entry == -1 || entry >= m_separation.Count() || m_separation[entry].truncated)
+		return false;
+
+	avoid = m_separation[entry].avoid;
+	avoidWeight = m_separation[entry].avoidWeight;
+	return true;
+}
@@ -0,0 +1,177 @@
+#ifndef _INCLUDE_INFECTED_GRID_H
+#define _INCLUDE_INFECTED_GRID_H
+
+#include <mathlib/vector.h>
+#include <utlvector.h>
+#include <const.h>
+
+class CBaseEntity;
+
+enum InfectedSnapshotFlags
+{
+	SNAPSHOT_ALIVE	= (1 << 0),
+};
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Per-frame structure of arrays of living infected, one element per infected.
+ * Batch passes read the columns they need without touching entity memory.
+ */
+struct InfectedSnapshot
+{
+	CUtlVector<float> x;
+	CUtlVector<float> y;
+	CUtlVector<float> z;
+	CUtlVector<float> hullWidth;			// 0 while the body isn't ready
+	CUtlVector<float> hullHeight;
+	CUtlVector<unsigned char> flags;		// InfectedSnapshotFlags
+	CUtlVector<CBaseEntity*> entity;
+	CUtlVector<int> index;					// entity index
+
+	void RemoveAll()
+	{
+		x.RemoveAll();
+		y.RemoveAll();
+		z.RemoveAll();
+		hullWidth.RemoveAll();
+		hullHeight.RemoveAll();
+		flags.RemoveAll();
+		entity.RemoveAll();
+		index.RemoveAll();
+	}
+
+	void SetCount(int count)
+	{
+		x.SetCount(count);
+		y.SetCount(count);
+		z.SetCount(count);
+		hullWidth.SetCount(count);
+		hullHeight.SetCount(count);
+		flags.SetCount(count);
+		entity.SetCount(count);
+		index.SetCount(count);
+	}
+
+	int Count() const { return x.Count(); }
+};
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Uniform spatial hash of living infected positions in the XY plane, pairs a hull height or more apart in Z never touch.
+ * The set of infected comes from the entity listener, positions are snapshotted once per server frame.
+ */
+class InfectedGrid
+{
+public:
+	static constexpr float CELL_SIZE = 64.0f;
+	static constexpr int BUCKET_COUNT = 1024;
+	static constexpr int MAX_NEIGHBORS = 64;
+	static constexpr int MAX_CANDIDATES = 256;
+
+	struct Stats
+	{
+		int gathers;
+		int truncated;				// gathers that hit MAX_CANDIDATES, their infected fell back to the neighbor list
+	};
+
+	InfectedGrid();
+
+	void Track(CBaseEntity* entity);
+	void Untrack(CBaseEntity* entity);
+	void Clear();
+
+	void Rebuild();
+
+	// push of an infected at origin against the snapshot; when more than maxCount are in contact only the nearest push.
+	// contacts receives the pushing infected and must hold maxCount entries, returns their number or -1 when too many
+	// infected were in range to gather them all, leaving avoid untouched
+	int Separate(const Vector& origin, float hullWidth, float hullHeight, const CBaseEntity* ignore, int maxCount, Vector& avoid, float& avoidWeight, CBaseEntity** contacts) const;
+
+	// visit every contacting pair of the snapshot once and accumulate the push of both sides
+	void SolveSeparation();
+
+	// result of SolveSeparation, false if the entity isn't part of this frame's snapshot or was in too crowded a spot
+	bool GetSeparation(CBaseEntity* entity, Vector& avoid, float& avoidWeight) const;
+
+	// invoke callback(CBaseEntity* them) for every infected the entity was in contact with in SolveSeparation
+	template<typename F>
+	void ForEachContact(CBaseEntity* entity, F&& callback) const;
+
+	const Stats& GetStats() const { return m_stats; }
+	void ResetStats() { m_stats = Stats(); }
+
+private:
+	struct Separation
+	{
+		Vector avoid;
+		float avoidWeight;
+		int firstContact;
+		bool truncated;				// some of its contacts may be missing
+	};
+
+	struct Contact
+	{
+		int other;					// snapshot element of the other infected
+		int next;
+	};
+
+	static inline int CellCoord(float value)
+	{
+		return (int)floorf(value * (1.0f / CELL_SIZE));
+	}
+
+	static inline int HashCell(int x, int y)
+	{
+		return ((unsigned int)(x * 73856093) ^ (unsigned int)(y * 19349663)) & (BUCKET_COUNT - 1);
+	}
+
+	// invoke callback(int element) for every snapshot element whose distance to origin is below radius on both XY axes
+	// and below height in Z
+	template<typename F>
+	void ForEachInRange(const Vector& origin, float radius, float height, F&& callback) const;
+
+	// snapshot elements above first in range of origin, XY positions are copied out for the kernel.
+	// Returns -1 when there are more than MAX_CANDIDATES
+	int GatherCandidates(const Vector& origin, float radius, float height, int first, const CBaseEntity* ignore, int* candidates, float* candX, float* candY) const;
+
+	int GetEntry(CBaseEntity* entity) const;
+	float GetHullWidth(CBaseEntity* entity, int index);
+
+	CUtlVector<CBaseEntity*> m_tracked;
+	int m_trackedIndex[MAX_EDICTS];			// position in m_tracked, -1 when not tracked
+	float m_hullWidth[MAX_EDICTS];			// fetched from the body once per entity
+	float m_hullHeight[MAX_EDICTS];
+
+	InfectedSnapshot m_snapshot;
+	CUtlVector<int> m_cellX;				// parallel to m_snapshot
+	CUtlVector<int> m_cellY;
+	CUtlVector<int> m_next;
+	int m_entryIndex[MAX_EDICTS];			// element of m_snapshot, -1 when not in the snapshot
+	int m_buckets[BUCKET_COUNT];
+
+	CUtlVector<Separation> m_separation;	// parallel to m_snapshot
+	CUtlVector<Contact> m_contacts;
+
+	mutable Stats m_stats;
+};
+
+template<typename F>
+inline void InfectedGrid::ForEachContact(CBaseEntity* entity, F&& callback) const
+{
+	int entry = GetEntry(entity);
+
+	if (entry == -1 || entry >= m_separation.Count() || m_separation[entry].truncated)
+		return;
+
+	for (int it = m_separation[entry].firstContact; it != -1; it = m_contacts[it].next)
+	{
+		CBaseEntity* them = m_snapshot.entity[m_contacts[it].other];
+
+		if (them)
+			callback(them);
+	}
+}
+
+extern InfectedGrid* infectedgrid;
+
+#endif // !_INCLUDE_INFECTED_GRID_H
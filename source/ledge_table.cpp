@@ -0,0 +1,97 @@
+#include "extension.h"
+#include "ledge_table.h"
+
+#include <mathlib/mathlib.h>
+#include <string.h>
+
+LedgeTable g_ledgeTable;
+LedgeTable* ledgetable = &g_ledgeTable;
+
+LedgeTable::LedgeTable() :
+	m_count(0),
+	m_stats()
+{
+	Clear();
+}
+
+void LedgeTable::Clear()
+{
+	for (int i = 0; i < CAPACITY; i++)
+		m_slots[i].used = false;
+
+	m_count = 0;
+}
+
+LedgeTable::Key LedgeTable::MakeKey(const Vector& landingGoal, const Vector& landingForward)
+{
+	Key key;
+
+	for (int i = 0; i < 3; i++)
+		key.goal[i] = (int)floorf(landingGoal[i] * (1.0f / GOAL_QUANTUM));
+
+	const float yaw = atan2f(landingForward.y, landingForward.x);
+	key.yaw = (int)floorf((yaw + M_PI_F) * (YAW_SECTORS / (2.0f * M_PI_F)) + 0.5f) % YAW_SECTORS;
+
+	return key;
+}
+
+uint32_t LedgeTable::HashKey(const Key& key)
+{
+	// FNV-1a over the key words
+	const uint32_t* words = reinterpret_cast<const uint32_t*>(&key);
+	uint32_t hash = 2166136261u;
+
+	for (size_t i = 0; i < sizeof(Key) / sizeof(uint32_t); i++)
+	{
+		hash ^= words[i];
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+bool LedgeTable::Find(const Vector& landingGoal, const Vector& landingForward, Vector& normal, Vector2D& offset)
+{
+	const Key key = MakeKey(landingGoal, landingForward);
+	const Slot& slot = m_slots[HashKey(key) & (CAPACITY - 1)];
+
+	m_stats.lookups++;
+
+	if (!slot.used || memcmp(&slot.key, &key, sizeof(Key)) != 0)
+		return false;
+
+	normal = slot.normal;
+	offset = slot.offset;
+
+	m_stats.hits++;
+	return true;
+}
+
+void LedgeTable::Store(const Vector& landingGoal, const Vector& landingForward, const Vector& normal, const Vector2D& offset)
+{
+	const Key key = MakeKey(landingGoal, landingForward);
+	Slot& slot = m_slots[HashKey(key) & (CAPACITY - 1)];
+
+	if (!slot.used)
+		m_count++;
+
+	slot.key = key;
+	slot.used = true;
+	slot.normal = normal;
+	slot.offset = offset;
+
+	m_stats.stores++;
+}
+
+void LedgeTable::Forget(const Vector& landingGoal, const Vector& landingForward)
+{
+	const Key key = MakeKey(landingGoal, landingForward);
+	Slot& slot = m_slots[HashKey(key) & (CAPACITY - 1)];
+
+	if (!slot.used || memcmp(&slot.key, &key, sizeof(Key)) != 0)
+		return;
+
+	slot.used = false;
+	m_count--;
+	m_stats.rejected++;
+}
@@ -0,0 +1,67 @@
+#ifndef _INCLUDE_LEDGE_TABLE_H
+#define _INCLUDE_LEDGE_TABLE_H
+
+#include <mathlib/vector.h>
+#include <stdint.h>
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Per-map direct-mapped table of ledges commons climbed, keyed by quantized landing goal and direction.
+ * Keeps the wall normal and the landing spot ClimbUpToLedge searched for, so the next climb of the same ledge only has to validate it.
+ */
+class LedgeTable
+{
+public:
+	static constexpr int CAPACITY_BITS = 12;
+	static constexpr int CAPACITY = 1 << CAPACITY_BITS;
+	static constexpr float GOAL_QUANTUM = 8.0f;
+	static constexpr int YAW_SECTORS = 16;
+
+	struct Stats
+	{
+		int lookups;
+		int hits;
+		int stores;
+		int rejected;		// hits the validation trace didn't agree with
+	};
+
+	LedgeTable();
+
+	void Clear();
+
+	// wall normal and XY offset from landingGoal to the landing spot of a ledge climbed before
+	bool Find(const Vector& landingGoal, const Vector& landingForward, Vector& normal, Vector2D& offset);
+	void Store(const Vector& landingGoal, const Vector& landingForward, const Vector& normal, const Vector2D& offset);
+	void Forget(const Vector& landingGoal, const Vector& landingForward);
+
+	int GetCount() const { return m_count; }
+
+	const Stats& GetStats() const { return m_stats; }
+	void ResetStats() { m_stats = Stats(); }
+
+private:
+	struct Key
+	{
+		int goal[3];
+		int yaw;
+	};
+
+	struct Slot
+	{
+		Key key;
+		bool used;
+		Vector normal;
+		Vector2D offset;
+	};
+
+	static Key MakeKey(const Vector& landingGoal, const Vector& landingForward);
+	static uint32_t HashKey(const Key& key);
+
+	Slot m_slots[CAPACITY];
+	int m_count;
+	Stats m_stats;
+};
+
+extern LedgeTable* ledgetable;
+
+#endif // !_INCLUDE_LEDGE_TABLE_H
@@ -0,0 +1,121 @@
+#include "extension.h"
+#include "mover_tracker.h"
+#include "resolve_collision_tools.h"
+
+static inline bool Overlaps(const Vector& mins1, const Vector& maxs1, const Vector& mins2, const Vector& maxs2)
+{
+	return mins1.x <= maxs2.x && maxs1.x >= mins2.x &&
+		mins1.y <= maxs2.y && maxs1.y >= mins2.y &&
+		mins1.z <= maxs2.z && maxs1.z >= mins2.z;
+}
+
+MoverTracker g_moverTracker;
+MoverTracker* movertracker = &g_moverTracker;
+
+MoverTracker::MoverTracker() :
+	m_regionCount(0)
+{
+	for (int i = 0; i < MAX_EDICTS; i++)
+		m_moverIndex[i] = -1;
+}
+
+void MoverTracker::Track(CBaseEntity* entity)
+{
+	int index = collisiontools->GetEntityIndex(entity);
+
+	if (index < 0 || index >= MAX_EDICTS || m_moverIndex[index] != -1)
+		return;
+
+	int position = m_movers.AddToTail();
+	Mover& mover = m_movers[position];
+
+	mover.entity = entity;
+	mover.origin = collisiontools->CBaseEntity_GetAbsOrigin(entity);
+	mover.angles = collisiontools->CBaseEntity_GetAbsAngles(entity);
+
+	m_moverIndex[index] = position;
+}
+
+void MoverTracker::Untrack(CBaseEntity* entity)
+{
+	int index = collisiontools->GetEntityIndex(entity);
+
+	if (index < 0 || index >= MAX_EDICTS || m_moverIndex[index] == -1)
+		return;
+
+	int position = m_moverIndex[index];
+	int last = m_movers.Count() - 1;
+
+	// whatever stood on or against it is gone now
+	MarkDirty(entity, m_movers[position].origin);
+
+	if (position != last)
+	{
+		m_movers[position] = m_movers[last];
+		m_moverIndex[collisiontools->GetEntityIndex(m_movers[position].entity)] = position;
+	}
+
+	m_movers.Remove(last);
+	m_moverIndex[index] = -1;
+}
+
+void MoverTracker::Clear()
+{
+	for (int i = 0; i < MAX_EDICTS; i++)
+		m_moverIndex[i] = -1;
+
+	m_movers.RemoveAll();
+	m_regionCount = 0;
+}
+
+void MoverTracker::Update()
+{
+	FOR_EACH_VEC(m_movers, it)
+	{
+		Mover& mover = m_movers[it];
+
+		const Vector& origin = collisiontools->CBaseEntity_GetAbsOrigin(mover.entity);
+		const QAngle& angles = collisiontools->CBaseEntity_GetAbsAngles(mover.entity);
+
+		if (origin == mover.origin && angles == mover.angles)
+			continue;
+
+		// both where it was and where it is now changed
+		MarkDirty(mover.entity, mover.origin);
+		MarkDirty(mover.entity, origin);
+
+		mover.origin = origin;
+		mover.angles = angles;
+	}
+}
+
+void MoverTracker::MarkDirty(CBaseEntity* entity, const Vector& origin)
+{
+	const float radius = collisiontools->CBaseEntity_GetBoundingRadius(entity);
+	Region& region = m_regions[m_regionCount % MAX_REGIONS];
+
+	region.mins = origin - Vector(radius, radius, radius);
+	region.maxs = origin + Vector(radius, radius, radius);
+	region.tick = gpGlobals->tickcount;
+
+	m_regionCount++;
+}
+
+bool MoverTracker::IsDirtySince(const Vector& mins, const Vector& maxs, int tick) const
+{
+	const int oldest = MAX(0, m_regionCount - MAX_REGIONS);
+
+	for (int i = m_regionCount - 1; i >= oldest; i--)
+	{
+		const Region& region = m_regions[i % MAX_REGIONS];
+
+		if (region.tick < tick)
+			return false;
+
+		if (Overlaps(mins, maxs, region.mins, region.maxs))
+			return true;
+	}
+
+	// forgotten regions may have been in range
+	return oldest > 0 && m_regions[oldest % MAX_REGIONS].tick >= tick;
+}
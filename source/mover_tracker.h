@@ -0,0 +1,59 @@
+#ifndef _INCLUDE_MOVER_TRACKER_H
+#define _INCLUDE_MOVER_TRACKER_H
+
+#include <mathlib/vector.h>
+#include <utlvector.h>
+#include <const.h>
+
+class CBaseEntity;
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Watches entities that can change the ground or walls under bots: props, doors, breakables and brush entities.
+ * Every tick a mover changed position, angles or was removed its bounds are recorded as a dirty region,
+ * so cached collision results can tell whether anything solid changed around them since they were made.
+ */
+class MoverTracker
+{
+public:
+	static constexpr int MAX_REGIONS = 128;
+
+	MoverTracker();
+
+	void Track(CBaseEntity* entity);
+	void Untrack(CBaseEntity* entity);
+	void Clear();
+
+	// compare movers against their last state, once per frame
+	void Update();
+
+	// true if a mover overlapped [mins, maxs] at or after tick, also when the history doesn't reach back that far
+	bool IsDirtySince(const Vector& mins, const Vector& maxs, int tick) const;
+
+private:
+	struct Mover
+	{
+		CBaseEntity* entity;
+		Vector origin;
+		QAngle angles;
+	};
+
+	struct Region
+	{
+		Vector mins;
+		Vector maxs;
+		int tick;
+	};
+
+	void MarkDirty(CBaseEntity* entity, const Vector& origin);
+
+	CUtlVector<Mover> m_movers;
+	int m_moverIndex[MAX_EDICTS];		// position in m_movers, -1 when not tracked
+
+	Region m_regions[MAX_REGIONS];		// ring, ordered by tick
+	int m_regionCount;					// regions ever added, the newest is at (m_regionCount - 1) % MAX_REGIONS
+};
+
+extern MoverTracker* movertracker;
+
+#endif // !_INCLUDE_MOVER_TRACKER_H
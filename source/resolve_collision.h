@@ -6,53 +6,228 @@
 #include "NextBotBodyInterface.h"
 
 #include <../extensions/sdkhooks/takedamageinfohack.h>
-#include <unordered_map>
+#include "entity_slots.h"
+#include "infected_grid.h"
+#include "contact_pairs.h"
+#include "trace_cache.h"
+#include "mover_tracker.h"
+#include "ground_heightfield.h"
+#include "ledge_table.h"
+#include "breakable_queue.h"
+
+// Moving physics props a bot got stuck in, each one ignored by its collision traces until its own expiry
+struct IgnoredProps
+{
+	static constexpr int CAPACITY = 6;
+
+	CBaseHandle handle[CAPACITY];
+	float expire[CAPACITY] = {};
+	int count = 0;
+
+	void Add(const CBaseHandle& prop, float until)
+	{
+		int slot = 0;
+
+		// refresh it if it's already here, else take a free slot or the one expiring first
+		for (int i = 0; i < count; i++)
+		{
+			if (handle[i] == prop)
+			{
+				expire[i] = until;
+				return;
+			}
+
+			if (expire[i] < expire[slot])
+				slot = i;
+		}
+
+		if (count < CAPACITY)
+			slot = count++;
+
+		handle[slot] = prop;
+		expire[slot] = until;
+	}
+
+	bool Contains(IHandleEntity* entity, float now) const
+	{
+		if (count == 0)
+			return false;
 
+		const CBaseHandle& prop = entity->GetRefEHandle();
+
+		for (int i = 0; i < count; i++)
+		{
+			if (handle[i] == prop)
+				return expire[i] > now;
+		}
+
+		return false;
+	}
+};
+
+// Timers are stored as raw expiry timestamps (-1 when invalid) to keep the record compact.
+// Only what every update reads lives here, state of optional features is in NextBotGroundCollisionFeatures
 struct NextBotGroundCollisionData
 {
+	Vector climb_dir = vec3_origin;
+
+	float nofall_timestamp = -1.0f;
+	float slope_timestamp = -1.0f;
+
 	bool is_climbing = false;
 	bool is_on_ground = false;
 
-	CountdownTimer nofall_timer;
-	CountdownTimer slope_timer;
+	// last world ground found by UpdateGroundConstraint, ground_tick is -1 when there is none to reuse
+	Vector ground_pos = vec3_origin;
+	Vector ground_end = vec3_origin;
+	Vector ground_normal = vec3_origin;
+	float ground_fraction = 1.0f;
+	int ground_tick = -1;
 
-	Vector climb_dir;
+	// depenetration isn't tried again before stuck_retry_tick, see stuck_pos
+	int stuck_retry_tick = -1;
+	int stuck_failures = 0;
+
+	// latest expiry in ignored_props, traces don't look at the set once it has passed
+	float ignored_props_expire = -1.0f;
 };
 
-std::unordered_map<NextBotGroundLocomotion*, NextBotGroundCollisionData> g_nextbot_collision_data;
+// Per-bot state of features touched only when they are enabled and in play, kept apart so it stays out of the cache
+struct NextBotGroundCollisionFeatures
+{
+	// rest state, still_tick is -1 while moving and sleep_tick is -1 while awake
+	Vector rest_pos = vec3_origin;
+	int rest_health = 0;
+	int still_tick = -1;
+	int sleep_tick = -1;
+
+	// last ClimbUpToLedge that found no wall, retries of it fail without tracing until climb_fail_expire
+	Vector climb_fail_feet = vec3_origin;
+	int climb_fail_goal[3] = { 0, 0, 0 };		// landing goal in CLIMB_FAIL_GOAL_QUANTUM units
+	int climb_fail_forward[3] = { 0, 0, 0 };	// landing forward in CLIMB_FAIL_FORWARD_QUANTUM units
+	unsigned long climb_fail_obstacle = 0;
+	float climb_fail_expire = -1.0f;
+	int climb_fail_tick = -1;
+
+	// last world plane ResolveCollision slid along, contact_pos is where our hull touched it
+	Vector contact_normal = vec3_origin;
+	Vector contact_pos = vec3_origin;
+	int contact_tick = -1;
+
+	// where we were found inside solid
+	Vector stuck_pos = vec3_origin;
+	int stuck_tick = -1;
+
+	IgnoredProps ignored_props;
+};
 
-extern ConVar z_resolve_zombie_collision_auto_multiplier;
+CEntitySlotStorage<NextBotGroundCollisionData> g_nextbot_collision_data;
+CEntitySlotStorage<NextBotGroundCollisionFeatures> g_nextbot_collision_features;
 
-ConVar z_resolve_zombie_climb_push_distance("z_resolve_zombie_climb_push_distance", "50.0");
+inline NextBotGroundCollisionData& NextBotGroundLocomotion::GetCollisionData()
+{
+	return g_nextbot_collision_data[collisiontools->GetEntityIndex(m_nextBot)];
+}
 
-class CBaseEntity
+inline NextBotGroundCollisionFeatures& NextBotGroundLocomotion::GetCollisionFeatures()
 {
-public:
-	virtual ~CBaseEntity() {};
-};
+	return g_nextbot_collision_features[collisiontools->GetEntityIndex(m_nextBot)];
+}
 
-class CPhysicsProp : public CBaseEntity
+struct ResolveCollisionStats
 {
-public:
-	virtual ~CPhysicsProp() {};
+	int detect_world_only;		// DetectCollision sweeps that didn't need the entity phase
+	int detect_entity;			// DetectCollision sweeps that traced entities
+	int traversable_lookups;
+	int traversable_hits;
+	int ground_traces;
+	int ground_reused;
+	int ground_heightfield;
+	int sleeps;
+	int wakes;
+	int sleeping_updates;		// ground and collision updates skipped by resting bots
+	int resolves[2];			// ResolveCollision calls by solver, 0 - single plane; 1 - multi-plane
+	int resolve_sweeps[2];		// DetectCollision sweeps by solver
+	int resolve_limits[2];		// calls that ran out of recursionLimit by solver
+	int startsolid_sweeps;		// DetectCollision sweeps that started inside solid
+	int stuck_bots;				// bots depenetration failed for and that were put on backoff
+	int stuck_skips;			// moves of backed off bots returned without a sweep
+	int depenetrations;
+	int depenetration_probes;
+	int contact_plane_hits;		// moves resolved by one sweep along the remembered contact plane
+	int contact_plane_misses;
+	int climbs;
+	int climb_traces;
+	int climb_fail_hits;		// climbs refused from the failed climb cache
 };
 
-class CBasePropDoor : public CBaseEntity
+ResolveCollisionStats g_resolveCollisionStats;
+
+// Verdicts of IsEntityTraversable for the current tick, valid while the entity state they were made in holds
+struct TraversableVerdict
 {
-public:
-	virtual ~CBasePropDoor() {};
+	int tick = -1;
+	int health = 0;
+	int collisionGroup = 0;
+	unsigned short solidFlags = 0;
+	unsigned char known = 0;		// bit per TraverseWhenType
+	unsigned char traversable = 0;
 };
 
-class CBreakableProp : public CBaseEntity
+CEntitySlotStorage<TraversableVerdict> g_traversable_verdicts;
+
+/**
+ * IsEntityTraversable answered once per tick for all commons.
+ * Other bots may override it with their own rules, so they always ask their locomotion.
+ */
+bool IsEntityTraversableCached(ILocomotion* locomotion, CBaseEntity* entity, ILocomotion::TraverseWhenType when, bool shared)
 {
-public:
-	virtual ~CBreakableProp() {};
-};
+	if (!shared || !g_settings.traversable_cache || entity == nullptr)
+		return locomotion->IsEntityTraversable(entity, when);
+
+	int index = collisiontools->GetEntityIndex(entity);
+
+	if (!g_traversable_verdicts.IsValidIndex(index))
+		return locomotion->IsEntityTraversable(entity, when);
+
+	TraversableVerdict& verdict = g_traversable_verdicts[index];
+
+	const int health = collisiontools->CBaseEntity_GetHealth(entity);
+	const int collisionGroup = collisiontools->CBaseEntity_GetCollisionGroup(entity);
+	const unsigned short solidFlags = collisiontools->CBaseEntity_GetSolidFlags(entity);
+	const unsigned char bit = (unsigned char)(1 << when);
+
+	g_resolveCollisionStats.traversable_lookups++;
+
+	if (verdict.tick != gpGlobals->tickcount || verdict.health != health || verdict.collisionGroup != collisionGroup || verdict.solidFlags != solidFlags)
+	{
+		verdict.tick = gpGlobals->tickcount;
+		verdict.health = health;
+		verdict.collisionGroup = collisionGroup;
+		verdict.solidFlags = solidFlags;
+		verdict.known = 0;
+		verdict.traversable = 0;
+	}
+	else if (verdict.known & bit)
+	{
+		g_resolveCollisionStats.traversable_hits++;
+		return (verdict.traversable & bit) != 0;
+	}
+
+	bool traversable = locomotion->IsEntityTraversable(entity, when);
+
+	verdict.known |= bit;
+
+	if (traversable)
+		verdict.traversable |= bit;
+
+	return traversable;
+}
 
 bool IgnoreActorsTraceFilterFunction(IHandleEntity* pServerEntity, int contentsMask)
 {
 	CBaseEntity* entity = EntityFromEntityHandle(pServerEntity);
-	return (collisiontools->MyInfectedPointer(entity) == NULL && !collisiontools->CBaseEntity_IsPlayer(entity));
+	return (collisiontools->GetEntityClass(entity) & (ENTITY_INFECTED | ENTITY_PLAYER)) == 0;
 }
 
 inline void GetClimbActivity(float height, float& heightAdjust, int& activity);
@@ -71,6 +246,7 @@ public:
 	{
 		m_bot = bot;
 		m_when = when;
+		m_shared = collisiontools->IsInfected((CBaseEntity*)bot->GetEntity());
 	}
 
 	virtual bool ShouldHitEntity(IHandleEntity* pServerEntity, int contentsMask)
@@ -84,7 +260,7 @@ public:
 		
 		if (CTraceFilterSimple::ShouldHitEntity(pServerEntity, contentsMask))
 		{
-			return !m_bot->GetLocomotionInterface()->IsEntityTraversable(entity, m_when);
+			return !IsEntityTraversableCached(m_bot->GetLocomotionInterface(), entity, m_when, m_shared);
 		}
 
 		return false;
@@ -93,6 +269,7 @@ public:
 private:
 	INextBot* m_bot;
 	ILocomotion::TraverseWhenType m_when;
+	bool m_shared;
 };
 
 class NextBotTraversableTraceIgnoreActorsFilter : public NextBotTraversableTraceFilter
@@ -116,22 +293,62 @@ public:
 class GroundLocomotionCollisionTraceFilter : public CTraceFilterSimple
 {
 public:
-	GroundLocomotionCollisionTraceFilter(INextBot* me, const IHandleEntity* passentity, int collisionGroup) : CTraceFilterSimple(passentity, collisionGroup)
+	GroundLocomotionCollisionTraceFilter(INextBot* me, const IHandleEntity* passentity, int collisionGroup, const IgnoredProps* ignored = nullptr) : CTraceFilterSimple(passentity, collisionGroup)
 	{
 		m_me = me;
+		m_self = (CBaseEntity*)me->GetEntity();
+		m_ignored = ignored;
 	}
 
 	virtual bool ShouldHitEntity(IHandleEntity* pServerEntity, int contentsMask)
 	{
+		if (m_ignored && !collisiontools->IsStaticProp(pServerEntity) && m_ignored->Contains(pServerEntity, gpGlobals->curtime))
+			return false;
+
+		// we already walked into it this frame, it breaks on the next one
+		if (g_settings.breakable_queue && !collisiontools->IsStaticProp(pServerEntity) && breakablequeue->IsPending(pServerEntity, m_self))
+			return false;
+
+		if (g_settings.native_trace_filter && GetCollisionGroup() == COLLISION_GROUP_NONE && (contentsMask & CONTENTS_WINDOW))
+			return ShouldHitEntityNative(pServerEntity, contentsMask);
+
 		return collisiontools->ZombieBotCollisionTraceFilter_ShouldHitEntity(this, pServerEntity, contentsMask);
 	}
 
+	// ZombieBotCollisionTraceFilter::ShouldHitEntity without calling into the game
+	bool ShouldHitEntityNative(IHandleEntity* pServerEntity, int contentsMask)
+	{
+		if (!collisiontools->ShouldHitEntitySimple(GetPassEntity(), pServerEntity, contentsMask))
+			return false;
+
+		if (collisiontools->IsStaticProp(pServerEntity))
+			return true;
+
+		CBaseEntity* entity = reinterpret_cast<CBaseEntity*>(pServerEntity);
+
+		if (entity == m_self)
+			return false;
+
+		int flags = collisiontools->GetEntityClass(entity);
+
+		// commons walk through each other, ResolveZombieCollisions separates them
+		if (flags & ENTITY_INFECTED)
+			return false;
+
+		if ((flags & ENTITY_PLAYER) && collisiontools->CTerrorPlayer_IsGhost(entity))
+			return false;
+
+		return true;
+	}
+
 	virtual TraceType_t GetTraceType() const override
 	{
 		return TRACE_EVERYTHING;
 	}
 
 	INextBot* m_me;
+	CBaseEntity* m_self;
+	const IgnoredProps* m_ignored;
 };
 
 class NextBotTraceFilterIgnoreActors : public CTraceFilterSimple
@@ -142,6 +359,113 @@ public:
 	}
 };
 
+// Forwards entity tests to another filter but restricts what the engine enumerates
+class TraceTypeFilter : public ITraceFilter
+{
+public:
+	TraceTypeFilter(ITraceFilter* filter, TraceType_t type) : m_filter(filter), m_type(type)
+	{
+	}
+
+	virtual bool ShouldHitEntity(IHandleEntity* pServerEntity, int contentsMask) override
+	{
+		return m_filter->ShouldHitEntity(pServerEntity, contentsMask);
+	}
+
+	virtual TraceType_t GetTraceType() const override
+	{
+		return m_type;
+	}
+
+private:
+	ITraceFilter* m_filter;
+	TraceType_t m_type;
+};
+
+// Stops at the first solid entity or static prop the filter would hit
+class SolidEntityEnumerator : public IPartitionEnumerator
+{
+public:
+	SolidEntityEnumerator(ITraceFilter* filter, int contentsMask) : m_filter(filter), m_contentsMask(contentsMask), m_found(false)
+	{
+	}
+
+	virtual IterationRetval_t EnumElement(IHandleEntity* pHandleEntity) override
+	{
+		if (!m_filter->ShouldHitEntity(pHandleEntity, m_contentsMask))
+			return ITERATION_CONTINUE;
+
+		m_found = true;
+		return ITERATION_STOP;
+	}
+
+	bool Found() const { return m_found; }
+
+private:
+	ITraceFilter* m_filter;
+	int m_contentsMask;
+	bool m_found;
+};
+
+/**
+ * Hull trace against the world first, entities are traced only if one the filter accepts overlaps the swept bounds.
+ * Same result as a TRACE_EVERYTHING trace with filter, the nearer of both hits wins.
+ */
+void CollisionTraceHull(const Vector& from, const Vector& to, const Vector& mins, const Vector& maxs, unsigned int mask, ITraceFilter* filter, trace_t* pTrace)
+{
+	Ray_t ray;
+
+	if (!g_settings.collision_split_trace || partition == nullptr)
+	{
+		ray.Init(from, to, mins, maxs);
+		enginetrace->TraceRay(ray, mask, filter, pTrace);
+		return;
+	}
+
+	// never shared through the trace cache, a sweep from a nearby start could leave us inside a brush
+	CTraceFilterWorldOnly worldFilter;
+	ray.Init(from, to, mins, maxs);
+	enginetrace->TraceRay(ray, mask, &worldFilter, pTrace);
+
+	// entities past the world hit can't be nearer
+	Vector sweepMins, sweepMaxs;
+	const Vector& end = pTrace->endpos;
+
+	for (int i = 0; i < 3; i++)
+	{
+		sweepMins[i] = MIN(from[i], end[i]) + mins[i] - 1.0f;
+		sweepMaxs[i] = MAX(from[i], end[i]) + maxs[i] + 1.0f;
+	}
+
+	SolidEntityEnumerator enumerator(filter, mask);
+	partition->EnumerateElementsInBox(PARTITION_ENGINE_SOLID_EDICTS | PARTITION_ENGINE_STATIC_PROPS, sweepMins, sweepMaxs, false, &enumerator);
+
+	if (!enumerator.Found())
+	{
+		g_resolveCollisionStats.detect_world_only++;
+		return;
+	}
+
+	g_resolveCollisionStats.detect_entity++;
+
+	trace_t entityTrace;
+	TraceTypeFilter entityFilter(filter, TRACE_ENTITIES_ONLY);
+
+	ray.Init(from, to, mins, maxs);
+	enginetrace->TraceRay(ray, mask, &entityFilter, &entityTrace);
+
+	const bool startsolid = pTrace->startsolid || entityTrace.startsolid;
+	const bool allsolid = pTrace->allsolid || entityTrace.allsolid;
+
+	if (entityTrace.fraction < pTrace->fraction)
+	{
+		*pTrace = entityTrace;
+	}
+
+	pTrace->startsolid = startsolid;
+	pTrace->allsolid = allsolid;
+}
+
 bool IsFlimsy(CBaseEntity* entity)
 {
 	static int m_collisionGroupOffs = collisiontools->GetDataOffset("CBaseEntity", "m_CollisionGroup");
@@ -157,9 +481,7 @@ bool IsFlimsy(CBaseEntity* entity)
 	if ((collisionGroup == COLLISION_GROUP_BREAKABLE_GLASS || collisionGroup == COLLISION_GROUP_NONE) &&
 		m_takedamage == 2 &&
 		m_iHealth <= 10 &&
-		(ClassMatchesComplex(entity, "func_breakable_surf") ||
-			ClassMatchesComplex(entity, "func_breakable") ||
-			dynamic_cast<CBreakableProp*>(entity) != nullptr))
+		collisiontools->IsBreakableClass(entity))
 	{
 		return true;
 	}
@@ -167,60 +489,78 @@ bool IsFlimsy(CBaseEntity* entity)
 	return false;
 }
 
+template<bool Debug>
 bool NextBotGroundLocomotion::DetectCollision(trace_t* pTrace, int& recursionLimit, const Vector& from, const Vector& to, const Vector& vecMins, const Vector& vecMaxs)
 {
 	IBody* body = GetBot()->GetBodyInterface();
 	
 	CBaseEntity* ignore = m_ignorePhysicsPropTimer.IsElapsed() ? NULL : collisiontools->BaseHandleToBaseEntity(m_ignorePhysicsProp);
-	GroundLocomotionCollisionTraceFilter filter(GetBot(), (IHandleEntity*)ignore, COLLISION_GROUP_NONE);
+	const bool ignoring = g_settings.ignore_props && GetCollisionData().ignored_props_expire > gpGlobals->curtime;
+	GroundLocomotionCollisionTraceFilter filter(GetBot(), (IHandleEntity*)ignore, COLLISION_GROUP_NONE, ignoring ? &GetCollisionFeatures().ignored_props : nullptr);
 	
-	TraceHull(from, to, vecMins, vecMaxs, body->GetSolidMask(), &filter, pTrace);
-
-	if (!pTrace->DidHit())
+	// retraced for as long as flimsy breakables are in the way
+	while (true)
 	{
-		if (z_resolve_collision_debug.GetBool())
-			NDebugOverlay::SweptBox(from, to, vecMins, vecMaxs, vec3_angle, 255, 255, 255, 255, 0.1f);
-		
-		return false;
-	}
+		CollisionTraceHull(from, to, vecMins, vecMaxs, body->GetSolidMask(), &filter, pTrace);
 
-	if (z_resolve_collision_debug.GetBool())
-		NDebugOverlay::SweptBox(from, to, vecMins, vecMaxs, vec3_angle, 255, 25, 25, 255, 0.1f);
+		if (!pTrace->DidHit())
+		{
+			if constexpr (Debug)
+				NDebugOverlay::SweptBox(from, to, vecMins, vecMaxs, vec3_angle, 255, 255, 255, 255, 0.1f);
+
+			return false;
+		}
+
+		if constexpr (Debug)
+			NDebugOverlay::SweptBox(from, to, vecMins, vecMaxs, vec3_angle, 255, 25, 25, 255, 0.1f);
+
+		//
+		// A collision occurred - resolve it
+		//
+
+		// bust through "flimsy" breakables and keep on going
+		if (!collisiontools->DidHitNonWorldEntity(pTrace) || pTrace->m_pEnt == NULL)
+			break;
 
-	//
-	// A collision occurred - resolve it
-	//
-	
-	// bust through "flimsy" breakables and keep on going
-	if (collisiontools->DidHitNonWorldEntity(pTrace) && pTrace->m_pEnt != NULL)
-	{
 		CBaseEntity* other = pTrace->m_pEnt;
-	
-		if (!collisiontools->MyCombatCharacterPointer(other) && IsEntityTraversable(other, IMMEDIATELY) && IsFlimsy( other ))
+
+		if (collisiontools->IsCombatCharacter(other) || !IsEntityTraversableCached(this, other, IMMEDIATELY, collisiontools->IsInfected(m_nextBot)) || !IsFlimsy(other))
+			break;
+
+		if (recursionLimit <= 0)
+			return true;
+
+		if (g_settings.breakable_queue)
+		{
+			// broken once on the next frame, pending until then so our retrace passes through it; the rest of the horde
+			// keeps colliding with it until it's really broken
+			if (!breakablequeue->Push(other, (CBaseEntity*)GetBot()->GetEntity(), GetMotionVector(), pTrace->endpos))
+				break;
+		}
+		else
 		{
-			if (recursionLimit <= 0)
-				return true;
-	
-			--recursionLimit;
-	
 			// break the weak breakable we collided with
 			CTakeDamageInfoHack damageInfo((CBaseEntity*)GetBot()->GetEntity(), (CBaseEntity*)GetBot()->GetEntity(), 100.0f, DMG_CRUSH, nullptr, vec3_origin, vec3_origin);
 			collisiontools->CalculateExplosiveDamageForce(&damageInfo, GetMotionVector(), pTrace->endpos);
 			collisiontools->TakeDamage(other, damageInfo);
-	
-			// retry trace now that the breakable is out of the way
-			return DetectCollision(pTrace, recursionLimit, from, to, vecMins, vecMaxs);
 		}
+
+		--recursionLimit;
+
+		// retry trace now that the breakable is out of the way
 	}
-	
-	/// @todo Only invoke OnContact() and Touch() once per collision pair
+
+	// slide iterations and crouch retries hit the same entity again, inform other components only once per frame
+	if (g_settings.collision_contact_once && pTrace->m_pEnt && contactpairs->Mark(m_nextBot, pTrace->m_pEnt, CONTACT_LOCOMOTION) == CONTACT_REPEAT)
+		return true;
+
 	// inform other components of collision
 	if (GetBot()->ShouldTouch(pTrace->m_pEnt))
 	{
 		GetBot()->OnContact(pTrace->m_pEnt, pTrace);
 	}
 	
-	INextBot* them = dynamic_cast<INextBot*>(pTrace->m_pEnt);
+	INextBot* them = collisiontools->IsNextBot(pTrace->m_pEnt) ? collisiontools->MyNextBotPointer(pTrace->m_pEnt) : nullptr;
 	if (them && them->ShouldTouch((CBaseEntity*)m_nextBot))
 	{
 		them->OnContact((CBaseEntity*)m_nextBot, pTrace);
@@ -233,14 +573,109 @@ bool NextBotGroundLocomotion::DetectCollision(trace_t* pTrace, int& recursionLim
 	return true;
 }
 
-void NextBotGroundLocomotion::UpdatePosition(const Vector& newPos)
+typedef Vector (NextBotGroundLocomotion::*ResolveCollisionFn_t)(const Vector& from, const Vector& to, int recursionLimit);
+
+// Instantiation matching the current z_resolve_collision / z_resolve_collision_debug / z_resolve_collision_solver, swapped by SelectResolveCollision
+ResolveCollisionFn_t g_resolveCollisionFn = &NextBotGroundLocomotion::ResolveCollision<true, false, false>;
+
+void SelectResolveCollision()
+{
+	static const ResolveCollisionFn_t instantiations[2][2][2] =
+	{
+		{
+			{ &NextBotGroundLocomotion::ResolveCollision<false, false, false>, &NextBotGroundLocomotion::ResolveCollision<false, false, true> },
+			{ &NextBotGroundLocomotion::ResolveCollision<false, true, false>, &NextBotGroundLocomotion::ResolveCollision<false, true, true> },
+		},
+		{
+			{ &NextBotGroundLocomotion::ResolveCollision<true, false, false>, &NextBotGroundLocomotion::ResolveCollision<true, false, true> },
+			{ &NextBotGroundLocomotion::ResolveCollision<true, true, false>, &NextBotGroundLocomotion::ResolveCollision<true, true, true> },
+		},
+	};
+
+	const bool fix = (g_settings.resolve_collision != 2);
+	const bool debug = (g_settings.resolve_collision_debug != 0);
+	const bool multiPlane = (g_settings.resolve_collision_solver != 0);
+
+	g_resolveCollisionFn = instantiations[fix][debug][multiPlane];
+}
+
+// Distances the depenetration probes try along each horizontal axis, nearest first, and the longest backoff in ticks after failing
+constexpr float DEPENETRATION_DISTANCES[] = { 2.0f, 6.0f, 16.0f };
+constexpr int DEPENETRATION_MAX_BACKOFF = 128;
+
+// Ticks a contact plane is remembered for since the sweep that hit it, and how far from it a bot may be to still be slid along it
+constexpr int CONTACT_PLANE_TICKS = 10;
+constexpr float CONTACT_PLANE_RANGE = 2.0f;
+
+// Planes a move is clipped against at once by the multi-plane solver, further ones are ignored
+constexpr int MAX_CLIP_PLANES = 5;
+
+// Classic multi-plane clip: slide move along one plane without going into any other, else along the crease of two.
+// Returns false when the planes leave no move worth another trace
+inline bool ClipMoveToPlanes(const Vector& move, const Vector* planes, int count, Vector& clipped)
+{
+	for (int i = 0; i < count; i++)
+	{
+		clipped = move - DotProduct(move, planes[i]) * planes[i];
+
+		int j = 0;
+		while (j < count && (j == i || DotProduct(clipped, planes[j]) >= 0.0f))
+			j++;
+
+		if (j == count)
+			return clipped.LengthSqr() >= 1.0f;
+	}
+
+	for (int i = 0; i < count; i++)
+	{
+		for (int j = i + 1; j < count; j++)
+		{
+			Vector crease = CrossProduct(planes[i], planes[j]);
+
+			if (VectorNormalize(crease) < 0.001f)
+				continue;
+
+			clipped = crease * DotProduct(crease, move);
+
+			int k = 0;
+			while (k < count && (k == i || k == j || DotProduct(clipped, planes[k]) >= 0.0f))
+				k++;
+
+			if (k == count)
+				return clipped.LengthSqr() >= 1.0f;
+		}
+	}
+
+	clipped = vec3_origin;
+	return false;
+}
+
+inline Vector NextBotGroundLocomotion::ResolveCollision(const Vector& from, const Vector& to, int recursionLimit)
 {
-	static ConVarRef NextBotStop("nb_stop");
+	if (g_settings.sleep_ticks > 0)
+	{
+		if (GetCollisionFeatures().sleep_tick != -1)
+		{
+			// nothing to resolve while we stay put
+			if (from.DistToSqr(to) < 0.0001f)
+			{
+				g_resolveCollisionStats.sleeping_updates++;
+				return to;
+			}
+
+			WakeUp();
+		}
+	}
+
+	return (this->*g_resolveCollisionFn)(from, to, recursionLimit);
+}
 
+void NextBotGroundLocomotion::UpdatePosition(const Vector& newPos)
+{
 	static int m_iEFlags_offset = collisiontools->GetDataOffset("CBaseEntity", "m_iEFlags");
 	const int& m_iEFLags = *reinterpret_cast<int*>((uintptr_t)m_nextBot + m_iEFlags_offset);
 
-	if (NextBotStop.GetBool() || (m_iEFLags & FL_FROZEN) != 0)
+	if (g_settings.nb_stop || (m_iEFLags & FL_FROZEN) != 0)
 	{
 		return;
 	}
@@ -256,6 +691,7 @@ void NextBotGroundLocomotion::UpdatePosition(const Vector& newPos)
 	GetBot()->SetPosition(safePos);
 }
 
+template<bool Fix, bool Debug, bool MultiPlane>
 Vector NextBotGroundLocomotion::ResolveCollision(const Vector& from, const Vector& to, int recursionLimit)
 {
 	IBody* body = GetBot()->GetBodyInterface();
@@ -265,29 +701,27 @@ Vector NextBotGroundLocomotion::ResolveCollision(const Vector& from, const Vecto
 		return to;
 	}
 
-	NextBotGroundCollisionData& data = g_nextbot_collision_data[this];
+	NextBotGroundCollisionData& data = GetCollisionData();
 
 	if (data.is_climbing && !HasClimbingActivity())
 	{
 		data.is_climbing = false;
 		data.is_on_ground = IsOnGround();
-		data.nofall_timer.Start(0.1f);
-		data.slope_timer.Start(0.1f);
+		data.nofall_timestamp = gpGlobals->curtime + 0.1f;
+		data.slope_timestamp = gpGlobals->curtime + 0.1f;
 	}
 
-	CountdownTimer& nofall = data.nofall_timer;
-
-	if (nofall.HasStarted() && !nofall.IsElapsed())
+	if (data.nofall_timestamp > 0.0f && gpGlobals->curtime <= data.nofall_timestamp)
 	{
-		if (!g_nextbot_collision_data[this].is_on_ground && IsOnGround())
+		if (!data.is_on_ground && IsOnGround())
 		{
-			nofall.Invalidate();
+			data.nofall_timestamp = -1.0f;
 		}
 		else if (from.z > to.z)
 		{
 			Vector& _to = const_cast<Vector&>(to);
 
-			_to += data.climb_dir * z_resolve_zombie_climb_push_distance.GetFloat() * GetUpdateInterval();
+			_to += data.climb_dir * g_settings.zombie_climb_push_distance * GetUpdateInterval();
 			_to.z = from.z;
 			
 			// I'm so sorry;
@@ -304,7 +738,7 @@ Vector NextBotGroundLocomotion::ResolveCollision(const Vector& from, const Vecto
 		}
 	}
 
-	if (z_resolve_collision_debug.GetInt() == 2)
+	if (Debug && g_settings.resolve_collision_debug == 2)
 		debugoverlay->ClearAllOverlays();
 
 	// get bounding limits, ignoring step-upable height
@@ -338,7 +772,7 @@ Vector NextBotGroundLocomotion::ResolveCollision(const Vector& from, const Vecto
 		bPerformCrouchTest = true;
 	}
 
-	if (z_resolve_collision_debug.GetBool())
+	if constexpr (Debug)
 	{
 		Vector dir = to - from;
 		dir.NormalizeInPlace();
@@ -350,9 +784,70 @@ Vector NextBotGroundLocomotion::ResolveCollision(const Vector& from, const Vecto
 	Vector resolvedGoal;
 	IBody::PostureType nPosture = IBody::STAND;
 
-	while (true)
+	Vector planes[MAX_CLIP_PLANES];
+	int planeCount = 0;
+
+	// still wedged where depenetration failed and nothing moved around us, the sweep would only start solid again
+	if (data.stuck_retry_tick > gpGlobals->tickcount && from == m_lastValidPos && from == GetCollisionFeatures().stuck_pos &&
+		!movertracker->IsDirtySince(from + mins, from + maxs, GetCollisionFeatures().stuck_tick))
+	{
+		g_resolveCollisionStats.stuck_skips++;
+		return m_lastValidPos;
+	}
+
+	g_resolveCollisionStats.resolves[MultiPlane]++;
+
+	// pressed against the wall we slid along last time, slide right away and confirm the wall still backs where we end up
+	bool preclipped = false;
+
+	NextBotGroundCollisionFeatures* contact = g_settings.contact_plane ? &GetCollisionFeatures() : nullptr;
+
+	if (contact && !bPerformCrouchTest && contact->contact_tick != -1 && gpGlobals->tickcount - contact->contact_tick <= CONTACT_PLANE_TICKS)
+	{
+		const Vector move = to - from;
+		const float into = DotProduct(move, contact->contact_normal);
+
+		// the plane is infinite but the wall isn't, only trust it close to where we touched it
+		const Vector offset = from - contact->contact_pos;
+		const float gap = DotProduct(offset, contact->contact_normal);
+		const Vector lateral = offset - gap * contact->contact_normal;
+		const float hullWidth = body->GetHullWidth();
+
+		if (into < 0.0f && gap < CONTACT_PLANE_RANGE && lateral.LengthSqr() < hullWidth * hullWidth)
+		{
+			const Vector slide = from + move - into * contact->contact_normal;
+			int limit = recursionLimit;
+
+			g_resolveCollisionStats.resolve_sweeps[MultiPlane]++;
+
+			if (!DetectCollision<Debug>(&trace, limit, from, slide, mins, maxs))
+			{
+				// past the end of the wall or at a doorway in it the move has to go around the corner instead
+				trace_t wall;
+				CTraceFilterWorldOnly worldFilter;
+				TraceHull(slide, slide - (CONTACT_PLANE_RANGE + 1.0f) * contact->contact_normal, mins, maxs, body->GetSolidMask(), &worldFilter, &wall);
+
+				if (!wall.startsolid && wall.fraction < 1.0f && DotProduct(wall.plane.normal, contact->contact_normal) > 0.99f)
+				{
+					g_resolveCollisionStats.contact_plane_hits++;
+					resolvedGoal = slide;
+					preclipped = true;
+				}
+			}
+
+			if (!preclipped)
+			{
+				g_resolveCollisionStats.contact_plane_misses++;
+				contact->contact_tick = -1;
+			}
+		}
+	}
+
+	while (!preclipped)
 	{
-		bool bCollided = DetectCollision(&trace, recursionLimit, from, desiredGoal, mins, maxs);
+		g_resolveCollisionStats.resolve_sweeps[MultiPlane]++;
+
+		bool bCollided = DetectCollision<Debug>(&trace, recursionLimit, from, desiredGoal, mins, maxs);
 		if (!bCollided)
 		{
 			resolvedGoal = desiredGoal;
@@ -360,7 +855,7 @@ Vector NextBotGroundLocomotion::ResolveCollision(const Vector& from, const Vecto
 		}
 
 		// If we hit really close to our target, then stop
-		if (z_resolve_collision.GetInt() == 2 && !trace.startsolid && desiredGoal.DistToSqr(trace.endpos) < 1.0f)
+		if (!Fix && !trace.startsolid && desiredGoal.DistToSqr(trace.endpos) < 1.0f)
 		{
 			resolvedGoal = trace.endpos;
 			break;
@@ -376,7 +871,7 @@ Vector NextBotGroundLocomotion::ResolveCollision(const Vector& from, const Vecto
 
 			nPosture = body->GetDesiredPosture();
 
-			if (!collisiontools->MyNextBotPointer(trace.m_pEnt) && !collisiontools->CBaseEntity_IsPlayer(trace.m_pEnt))
+			if ((collisiontools->GetEntityClass(trace.m_pEnt) & (ENTITY_NEXTBOT | ENTITY_PLAYER)) == 0)
 			{
 				// Here, our standing trace hit the world or something non-breakable
 				// If we're not currently crouching, then see if we could travel
@@ -426,7 +921,7 @@ Vector NextBotGroundLocomotion::ResolveCollision(const Vector& from, const Vecto
 			if (trace.m_pEnt && !collisiontools->IsWorld(trace.m_pEnt))
 			{
 				// only ignore physics props that are not doors
-				if (dynamic_cast<CPhysicsProp*>(trace.m_pEnt) != NULL && dynamic_cast<CBasePropDoor*>(trace.m_pEnt) == NULL)
+				if ((collisiontools->GetEntityClass(trace.m_pEnt) & (ENTITY_PHYSICS_PROP | ENTITY_PROP_DOOR)) == ENTITY_PHYSICS_PROP)
 				{
 					IPhysicsObject* physics = collisiontools->GetPhysicsObject(trace.m_pEnt);
 					if (physics && physics->IsMoveable())
@@ -434,18 +929,44 @@ Vector NextBotGroundLocomotion::ResolveCollision(const Vector& from, const Vecto
 						// we've intersected a (likely moving) physics prop - ignore it for awhile so we can move out of it
 						m_ignorePhysicsProp = ((IHandleEntity*)trace.m_pEnt)->GetRefEHandle();
 						m_ignorePhysicsPropTimer.Start(1.0f);
+
+						// the game forgets the previous prop here, the set keeps ignoring it so we don't bounce between two
+						if (g_settings.ignore_props)
+						{
+							GetCollisionFeatures().ignored_props.Add(m_ignorePhysicsProp, gpGlobals->curtime + 1.0f);
+							data.ignored_props_expire = MAX(data.ignored_props_expire, gpGlobals->curtime + 1.0f);
+						}
 					}
 				}
 			}
 
-			// return to last known non-interpenetrating position
-			resolvedGoal = m_lastValidPos;
+			g_resolveCollisionStats.startsolid_sweeps++;
+
+			// a door swinging through us would push us to its other side, the game's way out is the only safe one there
+			const bool door = trace.m_pEnt && collisiontools->IsPropDoor(trace.m_pEnt);
+
+			// out along the plane we're stuck in if the engine reported one, else back the way we came
+			Vector away = trace.plane.normal;
+			away.z = 0.0f;
+
+			if (away.NormalizeInPlace() < 0.5f)
+			{
+				away = m_lastValidPos - from;
+				away.z = 0.0f;
+				away.NormalizeInPlace();
+			}
+
+			// step out the shortest way we can find, else return to last known non-interpenetrating position
+			if (!g_settings.depenetrate || door || !Depenetrate(from, mins, maxs, away, resolvedGoal))
+				resolvedGoal = m_lastValidPos;
+
 			break;
 		}
 
 		if (--recursionLimit <= 0)
 		{
 			// reached recursion limit, no more adjusting allowed
+			g_resolveCollisionStats.resolve_limits[MultiPlane]++;
 			resolvedGoal = trace.endpos;
 			break;
 		}
@@ -471,23 +992,52 @@ Vector NextBotGroundLocomotion::ResolveCollision(const Vector& from, const Vecto
 			trace.plane.normal.NormalizeInPlace();
 		}
 
-		float blocked = DotProduct(trace.plane.normal, leftToMove);
+		// the world stays put, remember it for the next move
+		if (contact && trace.m_pEnt && collisiontools->IsWorld(trace.m_pEnt))
+		{
+			contact->contact_normal = trace.plane.normal;
+			contact->contact_pos = trace.endpos;
+			contact->contact_tick = gpGlobals->tickcount;
+		}
 
-		Vector unconstrained = fullMove - blocked * trace.plane.normal;
+		Vector unconstrained;
 
-		// check for collisions along remainder of move
-		// But don't bother if we're not going to deflect much
-		Vector remainingMove = from + unconstrained;
-		if (z_resolve_collision.GetInt() == 2 && remainingMove.DistToSqr(trace.endpos) < 1.0f)
+		if constexpr (MultiPlane)
 		{
-			resolvedGoal = trace.endpos;
-			break;
-		}
+			// slide the rest of the move along every plane hit so far instead of just the last one
+			if (planeCount < MAX_CLIP_PLANES)
+				planes[planeCount++] = trace.plane.normal;
+
+			Vector clipped;
+
+			if (!ClipMoveToPlanes(leftToMove, planes, planeCount, clipped))
+			{
+				resolvedGoal = trace.endpos;
+				break;
+			}
+
+			unconstrained = fullMove - leftToMove + clipped;
+		}
+		else
+		{
+			float blocked = DotProduct(trace.plane.normal, leftToMove);
+
+			unconstrained = fullMove - blocked * trace.plane.normal;
+		}
+
+		// check for collisions along remainder of move
+		// But don't bother if we're not going to deflect much
+		Vector remainingMove = from + unconstrained;
+		if (!Fix && remainingMove.DistToSqr(trace.endpos) < 1.0f)
+		{
+			resolvedGoal = trace.endpos;
+			break;
+		}
 
 		desiredGoal = remainingMove;
 	}
 
-	if (z_resolve_collision_debug.GetBool())
+	if constexpr (Debug)
 	{
 		Vector dir = to - desiredGoal;
 		dir.NormalizeInPlace();
@@ -497,6 +1047,12 @@ Vector NextBotGroundLocomotion::ResolveCollision(const Vector& from, const Vecto
 	if (!trace.startsolid)
 	{
 		m_lastValidPos = from;
+
+		if (data.stuck_failures != 0 || data.stuck_retry_tick != -1)
+		{
+			data.stuck_retry_tick = -1;
+			data.stuck_failures = 0;
+		}
 	}
 
 	if (m_bRecomputePostureOnCollision)
@@ -516,34 +1072,46 @@ Vector NextBotGroundLocomotion::ResolveZombieCollisions(const Vector& pos)
 {
 	Vector adjustedNewPos = pos;
 
-	CBaseEntity* me = collisiontools->MyInfectedPointer(m_nextBot);
+	CBaseEntity* me = collisiontools->IsInfected(m_nextBot) ? m_nextBot : NULL;
 	const float hullWidth = GetBot()->GetBodyInterface()->GetHullWidth();
 	const float dt = GetUpdateInterval();
-	const float mul = z_resolve_zombie_collision_multiplier.GetFloat();
+	const float mul = g_settings.zombie_collision_multiplier;
 
 
 	// only avoid if we're actually trying to move somewhere, and are enraged
 	if (me != NULL && !IsUsingLadder() && !IsClimbingOrJumping() && IsOnGround() && collisiontools->CBaseEntity_IsAlive(m_nextBot) && IsAttemptingToMove() /*&& GetBot()->GetBodyInterface()->IsArousal( IBody::INTENSE )*/)
 	{
-		const CUtlVector< CHandle< CBaseEntity > >& neighbors = collisiontools->Infected_GetNeighbors(me);
+		const Vector& myOrigin = collisiontools->CBaseEntity_GetAbsOrigin(me);
 		Vector avoid = vec3_origin;
 		float avoidWeight = 0.0f;
-	
-		FOR_EACH_VEC(neighbors, it)
-		{
-			CBaseEntity* them = gamehelpers->ReferenceToEntity(neighbors[it].GetEntryIndex());
 
-			if (them)
+		auto touchNeighbor = [me](CBaseEntity* them)
+			{
+				if (!g_settings.collision_contact_once && g_settings.zombie_collision_touch == 0)
+				{
+					collisiontools->CBaseEntity_Touch(me, them);
+					return;
+				}
+
+				ContactState state = contactpairs->Mark(me, them, CONTACT_INFECTED);
+
+				if (state == CONTACT_BEGIN || (state == CONTACT_PERSIST && g_settings.zombie_collision_touch == 0))
+				{
+					collisiontools->CBaseEntity_Touch(me, them);
+				}
+			};
+
+		auto avoidNeighbor = [&](CBaseEntity* them, const Vector& theirOrigin)
 			{
-				Vector toThem = (collisiontools->CBaseEntity_GetAbsOrigin(them) - collisiontools->CBaseEntity_GetAbsOrigin(me));
+				Vector toThem = theirOrigin - myOrigin;
 				toThem.z = 0.0f;
-	
+
 				float range = toThem.NormalizeInPlace();
 
 				if (range < hullWidth)
 				{
 					// these two infected are in contact
-					collisiontools->CBaseEntity_Touch(me, them);
+					touchNeighbor(them);
 					
 					// move out of contact
 					float penetration = (hullWidth - range);
@@ -552,6 +1120,51 @@ Vector NextBotGroundLocomotion::ResolveZombieCollisions(const Vector& pos)
 					avoid += -weight * toThem;
 					avoidWeight += weight;
 				}
+			};
+
+		// the grid gives up where it's too crowded to gather every contact, the neighbor list always has them
+		bool separated = false;
+
+		if (g_settings.resolve_zombie_collision == 2)
+		{
+			// pairs were solved once for everyone at the start of the frame
+			if (infectedgrid->GetSeparation(me, avoid, avoidWeight))
+			{
+				infectedgrid->ForEachContact(me, touchNeighbor);
+				separated = true;
+			}
+		}
+		else if (g_settings.zombie_collision_neighbors == 1)
+		{
+			CBaseEntity* contacts[InfectedGrid::MAX_NEIGHBORS];
+			int maxCount = g_settings.zombie_collision_max_neighbors;
+
+			if (maxCount <= 0 || maxCount > InfectedGrid::MAX_NEIGHBORS)
+				maxCount = InfectedGrid::MAX_NEIGHBORS;
+
+			int count = infectedgrid->Separate(myOrigin, hullWidth, GetBot()->GetBodyInterface()->GetHullHeight(), me, maxCount, avoid, avoidWeight, contacts);
+
+			for (int i = 0; i < count; i++)
+			{
+				// these two infected are in contact
+				touchNeighbor(contacts[i]);
+			}
+
+			separated = count != -1;
+		}
+
+		if (!separated)
+		{
+			const CUtlVector< CHandle< CBaseEntity > >& neighbors = collisiontools->Infected_GetNeighbors(me);
+
+			FOR_EACH_VEC(neighbors, it)
+			{
+				CBaseEntity* them = gamehelpers->ReferenceToEntity(neighbors[it].GetEntryIndex());
+
+				if (them)
+				{
+					avoidNeighbor(them, collisiontools->CBaseEntity_GetAbsOrigin(them));
+				}
 			}
 		}
 	
@@ -559,7 +1172,7 @@ Vector NextBotGroundLocomotion::ResolveZombieCollisions(const Vector& pos)
 		{
 			Vector collision = avoid / avoidWeight;
 			
-			if (z_resolve_zombie_collision_auto_multiplier.GetBool())
+			if (g_settings.zombie_collision_auto_multiplier)
 			{
 				collision *= (dt / 0.1f);
 			}
@@ -575,6 +1188,106 @@ Vector NextBotGroundLocomotion::ResolveZombieCollisions(const Vector& pos)
 	return adjustedNewPos;
 }
 
+// ClimbUpToLedge offsets, in hull widths, the game steps through when searching for the wall and the landing spot
+constexpr float CLIMB_WALL_STEP = 0.5f;
+constexpr int CLIMB_WALL_STEPS = 6;
+constexpr float CLIMB_LANDING_STEP = 0.25f;
+constexpr int CLIMB_LANDING_STEPS = 13;
+
+// Failed climbs are remembered by their landing goal and forward quantized to these,
+// and forgotten once the bot's feet move further than CLIMB_FAIL_MOVE from where it failed
+constexpr float CLIMB_FAIL_GOAL_QUANTUM = 4.0f;
+constexpr float CLIMB_FAIL_FORWARD_QUANTUM = 1.0f / 16.0f;
+constexpr float CLIMB_FAIL_MOVE = 4.0f;
+
+// how far in front of a plane a box's origin has to be for none of the box to be behind it
+inline float BoxSupport(const Vector& normal, const Vector& mins, const Vector& maxs)
+{
+	float support = 0.0f;
+
+	for (int i = 0; i < 3; i++)
+		support += MAX(-normal[i] * mins[i], -normal[i] * maxs[i]);
+
+	return support;
+}
+
+// First of count steps the probe holds for, -1 if none, like stepping through them one by one. Probes usually fail up to some
+// step and hold from it on, so the last step is tried first, then the predicted one and its neighbour, then bisection.
+// Bisection only ever answers a step whose predecessor was seen failing, and when the last step fails the probes aren't
+// monotone at all and the steps are walked one by one. Every step is traced at most once
+template<typename Probe, typename Predict>
+int FindClimbStep(int count, Probe&& probe, Predict&& predict)
+{
+	constexpr int MAX_STEPS = 16;
+	Assert(count <= MAX_STEPS);
+
+	signed char known[MAX_STEPS];		// -1 not probed, else the result
+	memset(known, -1, sizeof(known));
+
+	auto test = [&](int step) -> bool
+		{
+			if (known[step] == -1)
+				known[step] = probe(step) ? 1 : 0;
+
+			return known[step] == 1;
+		};
+
+	auto scan = [&]() -> int
+		{
+			for (int step = 0; step < count; step++)
+			{
+				if (test(step))
+					return step;
+			}
+
+			return -1;
+		};
+
+	if (!g_settings.zombie_climb_up_ledge_bisect)
+		return scan();
+
+	int lo = 0, hi = count - 1;
+
+	// blocked far out but maybe clear close by, behind the bot or under an overhang
+	if (!test(hi))
+		return scan();
+
+	// predict gives the fractional step, kept in range before it's turned into one
+	const int seed = (int)ceilf(MIN(MAX(predict(), (float)lo), (float)hi));
+
+	if (seed < hi)
+	{
+		if (test(seed))
+		{
+			if (seed == lo || !test(seed - 1))
+				return seed;
+
+			hi = seed - 1;
+		}
+		else
+		{
+			lo = seed + 1;
+		}
+	}
+
+	// hi is always the last step the probe held for, lo - 1 the last one it failed for
+	while (lo < hi)
+	{
+		const int mid = (lo + hi) / 2;
+
+		if (test(mid))
+			hi = mid;
+		else
+			lo = mid + 1;
+	}
+
+	// never trust a step without having seen the one before it fail
+	if (hi > 0 && test(hi - 1))
+		return scan();
+
+	return hi;
+}
+
 bool NextBotGroundLocomotion::ClimbUpToLedgeThunk(const Vector& landingGoal, const Vector& landingForward, const CBaseEntity* obstacle)
 {
 	INextBot* bot = GetBot();
@@ -599,72 +1312,84 @@ bool NextBotGroundLocomotion::ClimbUpToLedgeThunk(const Vector& landingGoal, con
 		mins.z = height;
 	}
 
-	float heightAdjust = 0.0f;
-	float hullWidth = body->GetHullWidth();
-	float hullWidthX3 = hullWidth * 3.0f;
+	const float hullWidth = body->GetHullWidth();
 
-	trace_t trace;
-	Vector start, end, normal;
-	Vector landingGoalResolve = landingGoal;
-	landingGoalResolve.z = feet.z;
+	NextBotGroundCollisionFeatures& data = GetCollisionFeatures();
 
-	while (true)
-	{
-		start = landingGoalResolve - (landingForward * heightAdjust);
-		end = feet + hullWidth * 10.0f * landingForward;
-
-		NextBotTraversableTraceIgnoreActorsFilter filter(bot, IMMEDIATELY);
-		TraceHull(start, end, mins, maxs, body->GetSolidMask(), &filter, &trace);
+	int goalKey[3], forwardKey[3];
+	const unsigned long obstacleKey = obstacle ? ((IHandleEntity*)obstacle)->GetRefEHandle().ToInt() : 0;
 
-		normal = trace.plane.normal;
-		heightAdjust = (hullWidth * 0.5) + heightAdjust;
-
-		if (hullWidthX3 < heightAdjust)
-			goto ret;
+	for (int i = 0; i < 3; i++)
+	{
+		goalKey[i] = (int)floorf(landingGoal[i] / CLIMB_FAIL_GOAL_QUANTUM);
+		forwardKey[i] = (int)floorf(landingForward[i] / CLIMB_FAIL_FORWARD_QUANTUM);
+	}
 
-		if (trace.startsolid || (trace.fraction >= 1.0 && !trace.allsolid))
+	// the path follower asks again every tick while we stand in front of the same obstacle
+	if (data.climb_fail_expire > gpGlobals->curtime)
+	{
+		Vector regionMins, regionMaxs;
+		VectorMin(feet, landingGoal, regionMins);
+		VectorMax(feet, landingGoal, regionMaxs);
+		regionMins -= Vector(hullWidth, hullWidth, 0.0f);
+		regionMaxs += Vector(hullWidth, hullWidth, body->GetHullHeight());
+
+		if (data.climb_fail_obstacle == obstacleKey && feet.DistToSqr(data.climb_fail_feet) <= CLIMB_FAIL_MOVE * CLIMB_FAIL_MOVE &&
+			memcmp(data.climb_fail_goal, goalKey, sizeof(goalKey)) == 0 && memcmp(data.climb_fail_forward, forwardKey, sizeof(forwardKey)) == 0 &&
+			!movertracker->IsDirtySince(regionMins, regionMaxs, data.climb_fail_tick))
 		{
-			continue;
-		}
+			g_resolveCollisionStats.climb_fail_hits++;
 
-		break;
-	}
+			m_velocity = vec3_origin;
+			m_acceleration = vec3_origin;
+			return false;
+		}
 
-	if (hullWidthX3 < heightAdjust || (trace.fraction >= 1.0 && !trace.allsolid))
-	{
-	ret:
-		m_velocity = vec3_origin;
-		m_acceleration = vec3_origin;
-		return false;
+		data.climb_fail_expire = -1.0f;
 	}
 
-	heightAdjust = 0.0f;
-	normal.z = 0.0f;
-	VectorNormalize(normal);
-
-	while (true)
-	{
-		start = normal * heightAdjust + landingGoalResolve;
+	Vector normal;
+	Vector2D ledgeOffset;
+	Vector landingGoalResolve = landingGoal;
+	landingGoalResolve.z = feet.z;
 
-		end = start;
-		end.z = landingGoal.z;
+	g_resolveCollisionStats.climbs++;
 
-		NextBotTraversableTraceIgnoreActorsFilter filter(bot);
-		TraceHull(start, end, body->GetHullMins(), body->GetHullMaxs(), body->GetSolidMask(), &filter, &trace);
+	// a ledge climbed before only needs its landing spot confirmed
+	bool known = false;
 
-		if (trace.fraction >= 1.0 && !trace.allsolid && !trace.startsolid)
-			break;
+	if (g_settings.zombie_climb_ledge_table && ledgetable->Find(landingGoal, landingForward, normal, ledgeOffset))
+	{
+		const Vector spot(landingGoal.x + ledgeOffset.x, landingGoal.y + ledgeOffset.y, feet.z);
 
-		heightAdjust = (hullWidth * 0.25f) + heightAdjust;
-		if (hullWidthX3 < heightAdjust)
+		if (IsLandingClear(spot, landingGoal.z))
 		{
-			goto label_61;
+			landingGoalResolve = spot;
+			known = true;
+		}
+		else
+		{
+			ledgetable->Forget(landingGoal, landingForward);
 		}
 	}
 
-	landingGoalResolve = normal * heightAdjust + landingGoalResolve;
+	if (!known && !SearchLedge(landingGoal, landingForward, mins, maxs, normal, landingGoalResolve))
+	{
+		if (g_settings.zombie_climb_fail_time > 0.0f)
+		{
+			data.climb_fail_feet = feet;
+			memcpy(data.climb_fail_goal, goalKey, sizeof(goalKey));
+			memcpy(data.climb_fail_forward, forwardKey, sizeof(forwardKey));
+			data.climb_fail_obstacle = obstacleKey;
+			data.climb_fail_expire = gpGlobals->curtime + g_settings.zombie_climb_fail_time;
+			data.climb_fail_tick = gpGlobals->tickcount;
+		}
+
+		m_velocity = vec3_origin;
+		m_acceleration = vec3_origin;
+		return false;
+	}
 
-label_61:
 	Vector goal, inverseNormal = -normal;
 	QAngle inverseAngle;
 
@@ -678,7 +1403,7 @@ label_61:
 	if (!body->StartActivity(activity, IBody::ACTIVITY_TRANSITORY | IBody::MOTION_CONTROLLED_XY | IBody::MOTION_CONTROLLED_Z))
 		return false;
 
-	if (z_resolve_zombie_climb_up_ledge_debug.GetBool())
+	if (g_settings.zombie_climb_up_ledge_debug)
 	{
 		NDebugOverlay::Line(landingGoal, goal, 255, 0, 0, true, 15.0f);
 		NDebugOverlay::Line(GetFeet(), landingGoal, 0, 255, 0, true, 15.0f);
@@ -691,14 +1416,102 @@ label_61:
 	body->SetDesiredPosture(IBody::CROUCH);
 	bot->OnLeaveGround(GetGround());
 
-	NextBotGroundCollisionData& data = g_nextbot_collision_data[this];
-
 	AngleVectors(inverseAngle, &data.climb_dir);
 	VectorNormalize(data.climb_dir);
 	data.is_climbing = true;
 	return true;
 }
 
+bool NextBotGroundLocomotion::SearchLedge(const Vector& landingGoal, const Vector& landingForward, const Vector& mins, const Vector& maxs, Vector& normal, Vector& landingGoalResolve)
+{
+	INextBot* bot = GetBot();
+	IBody* body = bot->GetBodyInterface();
+
+	const Vector& feet = GetFeet();
+	const float hullWidth = body->GetHullWidth();
+	const unsigned int mask = body->GetSolidMask();
+
+	trace_t trace, walls[CLIMB_WALL_STEPS];
+
+	// back off from the landing goal until a sweep towards the obstacle starts clear and hits its wall
+	const Vector wallEnd = feet + hullWidth * 10.0f * landingForward;
+
+	auto probeWall = [&](int step) -> bool
+		{
+			NextBotTraversableTraceIgnoreActorsFilter filter(bot, IMMEDIATELY);
+			TraceHull(landingGoalResolve - landingForward * (step * CLIMB_WALL_STEP * hullWidth), wallEnd, mins, maxs, mask, &filter, &trace);
+			g_resolveCollisionStats.climb_traces++;
+
+			if (trace.startsolid || (trace.fraction >= 1.0f && !trace.allsolid))
+				return false;
+
+			walls[step] = trace;
+			return true;
+		};
+
+	// the start is clear once its box is entirely in front of the wall plane, predicted from the farthest start
+	auto predictWall = [&]() -> float
+		{
+			const trace_t& wall = walls[CLIMB_WALL_STEPS - 1];
+			const float rate = -DotProduct(wall.plane.normal, landingForward) * CLIMB_WALL_STEP * hullWidth;
+			const float side = DotProduct(wall.plane.normal, landingGoalResolve) - wall.plane.dist;
+
+			return rate > 0.0f ? (BoxSupport(wall.plane.normal, mins, maxs) - side) / rate : (float)CLIMB_WALL_STEPS;
+		};
+
+	const int wallStep = FindClimbStep(CLIMB_WALL_STEPS, probeWall, predictWall);
+
+	if (wallStep == -1)
+		return false;
+
+	const trace_t& wall = walls[wallStep];
+
+	normal = wall.plane.normal;
+	normal.z = 0.0f;
+	VectorNormalize(normal);
+
+	// then move out along the wall until the whole hull rises clear to the landing height
+	auto probeLanding = [&](int step) -> bool
+		{
+			return IsLandingClear(normal * (step * CLIMB_LANDING_STEP * hullWidth) + landingGoalResolve, landingGoal.z);
+		};
+
+	auto predictLanding = [&]() -> float
+		{
+			const float rate = DotProduct(wall.plane.normal, normal) * CLIMB_LANDING_STEP * hullWidth;
+			const float side = DotProduct(wall.plane.normal, landingGoalResolve) - wall.plane.dist;
+
+			return rate > 0.0f ? (BoxSupport(wall.plane.normal, body->GetHullMins(), body->GetHullMaxs()) - side) / rate : 0.0f;
+		};
+
+	const int landingStep = FindClimbStep(CLIMB_LANDING_STEPS, probeLanding, predictLanding);
+
+	if (landingStep != -1)
+	{
+		landingGoalResolve = normal * (landingStep * CLIMB_LANDING_STEP * hullWidth) + landingGoalResolve;
+
+		if (g_settings.zombie_climb_ledge_table)
+			ledgetable->Store(landingGoal, landingForward, normal, (landingGoalResolve - landingGoal).AsVector2D());
+	}
+
+	return true;
+}
+
+bool NextBotGroundLocomotion::IsLandingClear(const Vector& spot, float landingHeight)
+{
+	IBody* body = GetBot()->GetBodyInterface();
+
+	Vector end = spot;
+	end.z = landingHeight;
+
+	trace_t trace;
+	NextBotTraversableTraceIgnoreActorsFilter filter(GetBot());
+	TraceHull(spot, end, body->GetHullMins(), body->GetHullMaxs(), body->GetSolidMask(), &filter, &trace);
+	g_resolveCollisionStats.climb_traces++;
+
+	return trace.fraction >= 1.0f && !trace.allsolid && !trace.startsolid;
+}
+
 void NextBotGroundLocomotion::UpdateGroundConstraint(void)
 {
 	// if we're up on the upward arc of our jump, don't interfere by snapping to ground
@@ -715,6 +1528,11 @@ void NextBotGroundLocomotion::UpdateGroundConstraint(void)
 		return;
 	}
 
+	if (UpdateSleep())
+	{
+		return;
+	}
+
 	float halfWidth = body->GetHullWidth() / 2.0f;
 
 	// since we only care about ground collisions, keep hull short to avoid issues with low ceilings
@@ -726,13 +1544,37 @@ void NextBotGroundLocomotion::UpdateGroundConstraint(void)
 	const float stickToGroundTolerance = GetStepHeight() + 0.01f;
 
 	trace_t ground;
-	NextBotTraceFilterIgnoreActors filter((IHandleEntity*)m_nextBot, COLLISION_GROUP_NONE);
 
-	TraceHull(GetBot()->GetPosition() + Vector(0, 0, GetStepHeight() + 0.001f),
-		GetBot()->GetPosition() + Vector(0, 0, -stickToGroundTolerance),
-		Vector(-halfWidth, -halfWidth, 0),
-		Vector(halfWidth, halfWidth, hullHeight),
-		body->GetSolidMask(), &filter, &ground);
+	if (!ReuseGroundTrace(halfWidth, hullHeight, stickToGroundTolerance, &ground) &&
+		!HeightfieldGroundTrace(halfWidth, hullHeight, stickToGroundTolerance, body->GetSolidMask(), &ground))
+	{
+		NextBotTraceFilterIgnoreActors filter((IHandleEntity*)m_nextBot, COLLISION_GROUP_NONE);
+
+		// hordes walking the same floor issue near identical ground traces
+		tracecache->TraceHull(GetBot()->GetPosition() + Vector(0, 0, GetStepHeight() + 0.001f),
+			GetBot()->GetPosition() + Vector(0, 0, -stickToGroundTolerance),
+			Vector(-halfWidth, -halfWidth, 0),
+			Vector(halfWidth, halfWidth, hullHeight),
+			body->GetSolidMask(), TRACE_CACHE_IGNORE_ACTORS, &filter, &ground);
+
+		g_resolveCollisionStats.ground_traces++;
+
+		NextBotGroundCollisionData& data = GetCollisionData();
+
+		// only the world stays where it was, anything else has to be traced again
+		if (!ground.startsolid && ground.fraction < 1.0f && ground.m_pEnt && collisiontools->IsWorld(ground.m_pEnt))
+		{
+			data.ground_pos = GetBot()->GetPosition();
+			data.ground_end = ground.endpos;
+			data.ground_normal = ground.plane.normal;
+			data.ground_fraction = ground.fraction;
+			data.ground_tick = gpGlobals->tickcount;
+		}
+		else
+		{
+			data.ground_tick = -1;
+		}
+	}
 
 	if (ground.startsolid)
 		return;
@@ -809,6 +1651,242 @@ void NextBotGroundLocomotion::UpdateGroundConstraint(void)
 	}
 }
 
+// Fills in a ground trace that never went through the engine the way a world hit would come back from it,
+// OnContact and the slope handling read more of it than the ground code does
+inline void SetWorldGroundTrace(const Vector& start, const Vector& end, const Vector& normal, float dist, float fraction, trace_t* ground)
+{
+	memset(ground, 0, sizeof(*ground));
+
+	ground->startpos = start;
+	ground->endpos = end;
+	ground->plane.normal = normal;
+	ground->plane.dist = dist;
+	ground->plane.type = normal.z == 1.0f ? PLANE_Z : PLANE_ANYZ;
+	ground->plane.signbits = SignbitsForPlane(&ground->plane);
+	ground->fraction = fraction;
+	ground->contents = CONTENTS_SOLID;
+	ground->surface.name = "**empty**";
+	ground->m_pEnt = gamehelpers->ReferenceToEntity(0);
+}
+
+bool NextBotGroundLocomotion::ReuseGroundTrace(float halfWidth, float hullHeight, float stickToGroundTolerance, trace_t* ground)
+{
+	if (!g_settings.ground_reuse)
+		return false;
+
+	NextBotGroundCollisionData& data = GetCollisionData();
+
+	if (data.ground_tick == -1)
+		return false;
+
+	const Vector& pos = GetBot()->GetPosition();
+	Vector delta = pos - data.ground_pos;
+
+	if (delta.LengthSqr() > g_settings.ground_reuse_distance * g_settings.ground_reuse_distance)
+		return false;
+
+	Vector mins = pos + Vector(-halfWidth, -halfWidth, -stickToGroundTolerance);
+	Vector maxs = pos + Vector(halfWidth, halfWidth, GetStepHeight() + hullHeight);
+
+	if (movertracker->IsDirtySince(mins, maxs, data.ground_tick))
+	{
+		data.ground_tick = -1;
+		return false;
+	}
+
+	// slide the old contact along the ground plane by how far we moved
+	Vector end = data.ground_end + delta;
+
+	if (data.ground_normal.z > 0.0f)
+		end.z = data.ground_end.z - (data.ground_normal.x * delta.x + data.ground_normal.y * delta.y) / data.ground_normal.z;
+
+	SetWorldGroundTrace(pos + Vector(0, 0, GetStepHeight() + 0.001f), end, data.ground_normal, DotProduct(data.ground_normal, end), data.ground_fraction, ground);
+
+	g_resolveCollisionStats.ground_reused++;
+	return true;
+}
+
+bool NextBotGroundLocomotion::HeightfieldGroundTrace(float halfWidth, float hullHeight, float stickToGroundTolerance, unsigned int mask, trace_t* ground)
+{
+	if (!g_settings.ground_heightfield || partition == nullptr)
+		return false;
+
+	const Vector& pos = GetBot()->GetPosition();
+	Vector normal;
+	float dist;
+
+	if (!groundheightfield->GetPlane(pos, halfWidth, mask, normal, dist))
+		return false;
+
+	// out of reach, let the real trace decide between starting solid and falling
+	if (!PlaneGroundTrace(normal, dist, halfWidth, stickToGroundTolerance, ground))
+		return false;
+
+	// props and brush entities aren't part of the heightfield
+	NextBotTraceFilterIgnoreActors filter((IHandleEntity*)m_nextBot, COLLISION_GROUP_NONE);
+	SolidEntityEnumerator enumerator(&filter, mask);
+
+	partition->EnumerateElementsInBox(PARTITION_ENGINE_SOLID_EDICTS | PARTITION_ENGINE_STATIC_PROPS,
+		pos + Vector(-halfWidth, -halfWidth, -stickToGroundTolerance), ground->startpos + Vector(halfWidth, halfWidth, hullHeight), false, &enumerator);
+
+	if (enumerator.Found())
+		return false;
+
+	g_resolveCollisionStats.ground_heightfield++;
+	return true;
+}
+
+bool NextBotGroundLocomotion::PlaneGroundTrace(const Vector& normal, float dist, float halfWidth, float stickToGroundTolerance, trace_t* ground)
+{
+	const Vector& pos = GetBot()->GetPosition();
+
+	// a box resting on a plane touches it with its highest bottom corner
+	const float height = (dist - normal.x * pos.x - normal.y * pos.y + (fabsf(normal.x) + fabsf(normal.y)) * halfWidth) / normal.z;
+
+	const Vector start = pos + Vector(0, 0, GetStepHeight() + 0.001f);
+	const Vector end = pos + Vector(0, 0, -stickToGroundTolerance);
+
+	if (height > start.z || height < end.z)
+		return false;
+
+	SetWorldGroundTrace(start, Vector(pos.x, pos.y, height), normal, dist, (start.z - height) / (start.z - end.z), ground);
+	return true;
+}
+
+bool NextBotGroundLocomotion::Depenetrate(const Vector& from, const Vector& mins, const Vector& maxs, const Vector& away, Vector& out)
+{
+	NextBotGroundCollisionData& data = GetCollisionData();
+
+	if (data.stuck_retry_tick > gpGlobals->tickcount)
+		return false;
+
+	// along the ground only, nearest to away first; rising out of solid would leave us hanging in the air
+	Vector directions[] = { Vector(1, 0, 0), Vector(-1, 0, 0), Vector(0, 1, 0), Vector(0, -1, 0) };
+
+	for (int i = 1; i < 4; i++)
+	{
+		for (int j = i; j > 0 && DotProduct(directions[j], away) > DotProduct(directions[j - 1], away); j--)
+		{
+			const Vector nearer = directions[j];
+			directions[j] = directions[j - 1];
+			directions[j - 1] = nearer;
+		}
+	}
+
+	// props we ignore, the one we just got stuck in included, still count; a spot inside them is no way out
+	IBody* body = GetBot()->GetBodyInterface();
+	GroundLocomotionCollisionTraceFilter filter(GetBot(), NULL, COLLISION_GROUP_NONE);
+
+	trace_t trace;
+
+	for (float distance : DEPENETRATION_DISTANCES)
+	{
+		for (const Vector& direction : directions)
+		{
+			const Vector probe = from + direction * distance;
+
+			TraceHull(probe, probe, mins, maxs, body->GetSolidMask(), &filter, &trace);
+			g_resolveCollisionStats.depenetration_probes++;
+
+			if (trace.startsolid)
+				continue;
+
+			// the spot has to be reachable from where we last stood clear, or we went through a thin wall
+			TraceHull(probe, m_lastValidPos, mins, maxs, body->GetSolidMask(), &filter, &trace);
+			g_resolveCollisionStats.depenetration_probes++;
+
+			if (trace.fraction >= 1.0f && !trace.startsolid)
+			{
+				g_resolveCollisionStats.depenetrations++;
+				data.stuck_failures = 0;
+				out = probe;
+				return true;
+			}
+		}
+	}
+
+	// wedged for good, back off exponentially so we stop paying for it every tick
+	if (data.stuck_failures++ == 0)
+		g_resolveCollisionStats.stuck_bots++;
+
+	NextBotGroundCollisionFeatures& features = GetCollisionFeatures();
+	features.stuck_pos = from;
+	features.stuck_tick = gpGlobals->tickcount;
+	data.stuck_retry_tick = gpGlobals->tickcount + MIN(1 << MIN(data.stuck_failures, 7), DEPENETRATION_MAX_BACKOFF);
+	return false;
+}
+
+bool NextBotGroundLocomotion::UpdateSleep(void)
+{
+	if (g_settings.sleep_ticks <= 0)
+		return false;
+
+	NextBotGroundCollisionFeatures& data = GetCollisionFeatures();
+
+	const Vector& pos = GetBot()->GetPosition();
+	const int health = collisiontools->CBaseEntity_GetHealth(m_nextBot);
+
+	// resting means standing on the world without anything asking us to move
+	const bool still = !IsAttemptingToMove() && IsOnGround() && !IsClimbingOrJumping() && !IsUsingLadder() &&
+		m_velocity.LengthSqr() < 0.01f && GetGround() && collisiontools->IsWorld(GetGround());
+
+	// pushed, hurt or started moving since we last looked
+	const bool disturbed = !still || health != data.rest_health || pos.DistToSqr(data.rest_pos) > 0.0001f;
+
+	if (data.sleep_tick != -1)
+	{
+		// a door, breakable or prop changing nearby may have taken our ground or walked into us
+		if (!disturbed)
+		{
+			IBody* body = GetBot()->GetBodyInterface();
+			const Vector extent(body->GetHullWidth(), body->GetHullWidth(), body->GetHullHeight());
+
+			if (!movertracker->IsDirtySince(pos - extent, pos + extent, data.sleep_tick))
+			{
+				g_resolveCollisionStats.sleeping_updates++;
+				return true;
+			}
+		}
+
+		WakeUp();
+		return false;
+	}
+
+	if (disturbed)
+	{
+		data.rest_pos = pos;
+		data.rest_health = health;
+		data.still_tick = still ? gpGlobals->tickcount : -1;
+		return false;
+	}
+
+	if (data.still_tick == -1)
+	{
+		data.still_tick = gpGlobals->tickcount;
+		return false;
+	}
+
+	if (gpGlobals->tickcount - data.still_tick >= g_settings.sleep_ticks)
+	{
+		data.sleep_tick = gpGlobals->tickcount;
+		g_resolveCollisionStats.sleeps++;
+	}
+
+	// the ground is only skipped from the next update on, this one still confirms it
+	return false;
+}
+
+void NextBotGroundLocomotion::WakeUp(void)
+{
+	NextBotGroundCollisionFeatures& data = GetCollisionFeatures();
+
+	if (data.sleep_tick != -1)
+		g_resolveCollisionStats.wakes++;
+
+	data.sleep_tick = -1;
+	data.still_tick = -1;
+}
+
 bool NextBotGroundLocomotion::DidJustJump(void) const
 {
 	const Vector& velocity = collisiontools->CBaseEntity_GetAbsVelocity(m_nextBot);
@@ -817,14 +1895,14 @@ bool NextBotGroundLocomotion::DidJustJump(void) const
 
 float NextBotGroundLocomotion::GetTraversableSlopeLimitThunk()
 {
-	CountdownTimer& slopeTimer = g_nextbot_collision_data[this].slope_timer;
+	float& slopeTimestamp = GetCollisionData().slope_timestamp;
 	float actualSlope = GetTraversableSlopeLimit();
 
-	if (slopeTimer.HasStarted())
+	if (slopeTimestamp > 0.0f)
 	{
-		if (slopeTimer.IsElapsed())
+		if (gpGlobals->curtime > slopeTimestamp)
 		{
-			slopeTimer.Invalidate();
+			slopeTimestamp = -1.0f;
 			return actualSlope;
 		}
 
@@ -836,12 +1914,7 @@ float NextBotGroundLocomotion::GetTraversableSlopeLimitThunk()
 
 inline float NextBotGroundLocomotion::GetGravity() const
 {
-	static ConVarRef nb_gravity("nb_gravity", false);
-
-	if (nb_gravity.IsValid())
-		return nb_gravity.GetFloat();
-
-	return 1000.0f;
+	return g_settings.nb_gravity;
 }
 
 inline bool NextBotGroundLocomotion::HasClimbingActivity()
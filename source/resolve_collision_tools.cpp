@@ -4,6 +4,30 @@
 ResolveCollisionTools g_collisionTools;
 ResolveCollisionTools* collisiontools = &g_collisionTools;
 
+class CBaseEntity
+{
+public:
+	virtual ~CBaseEntity() {};
+};
+
+class CPhysicsProp : public CBaseEntity
+{
+public:
+	virtual ~CPhysicsProp() {};
+};
+
+class CBasePropDoor : public CBaseEntity
+{
+public:
+	virtual ~CBasePropDoor() {};
+};
+
+class CBreakableProp : public CBaseEntity
+{
+public:
+	virtual ~CBreakableProp() {};
+};
+
 ResolveCollisionTools::ResolveCollisionTools()
 {
 	m_CTraceFilterSimple_ShouldHitEntity = nullptr;
@@ -21,7 +45,19 @@ ResolveCollisionTools::ResolveCollisionTools()
 	m_Infected_m_vecNeighbors = -1;
 	m_CBaseEntity_m_vecAbsOrigin = -1;
 	m_CBaseEntity_m_vecAbsVelocity = -1;
+	m_CBaseEntity_m_angAbsRotation = -1;
+	m_CBaseEntity_m_vecMins = -1;
+	m_CBaseEntity_m_vecMaxs = -1;
 	m_CBaseEntity_m_hGroundEntity = -1;
+	m_CBaseEntity_m_hOwnerEntity = -1;
+	m_CBaseEntity_m_CollisionGroup = -1;
+	m_CBaseEntity_m_MoveType = -1;
+	m_CBaseEntity_m_ModelName = -1;
+	m_CBaseEntity_m_nSolidType = -1;
+	m_CBaseEntity_m_usSolidFlags = -1;
+	m_CBaseEntity_m_iHealth = -1;
+	m_CBaseEntity_m_pPhysicsObject = -1;
+	m_CTerrorPlayer_m_isGhost = -1;
 }
 
 bool ResolveCollisionTools::Initialize(SourceMod::IGameConfig* config)
@@ -72,28 +108,156 @@ bool ResolveCollisionTools::Initialize(SourceMod::IGameConfig* config)
 	return ok;
 }
 
-// https://github.com/asherkin/vphysics/blob/d5e0287bb11b3a06dd727e66a9f3442e693dcf58/extension/physnatives.cpp#L1034-L1055
-IPhysicsObject* ResolveCollisionTools::GetPhysicsObject(CBaseEntity* pEntity)
+int ResolveCollisionTools::ClassifyEntity(CBaseEntity* entity, const char* classname)
 {
-	datamap_t* data = gamehelpers->GetDataMap(pEntity);
+	int flags = ENTITY_CLASSIFIED;
+
+	if (MyInfectedPointer(entity) != nullptr)
+		flags |= ENTITY_INFECTED;
+
+	if (CBaseEntity_IsPlayer(entity))
+		flags |= ENTITY_PLAYER;
+
+	if (MyNextBotPointer(entity) != nullptr)
+		flags |= ENTITY_NEXTBOT;
+
+	if (MyCombatCharacterPointer(entity) != nullptr)
+		flags |= ENTITY_COMBAT_CHARACTER;
+
+	if (dynamic_cast<CPhysicsProp*>(entity) != nullptr)
+		flags |= ENTITY_PHYSICS_PROP;
+
+	if (dynamic_cast<CBasePropDoor*>(entity) != nullptr)
+		flags |= ENTITY_PROP_DOOR;
+
+	if (classname == nullptr)
+		classname = gamehelpers->GetEntityClassname(entity);
 
-	if (!data)
+	if (dynamic_cast<CBreakableProp*>(entity) != nullptr ||
+		(classname && (strcmp(classname, "func_breakable_surf") == 0 || strcmp(classname, "func_breakable") == 0)))
 	{
-		return NULL;
+		flags |= ENTITY_BREAKABLE;
 	}
 
-	typedescription_t* type = gamehelpers->FindInDataMap(data, "m_pPhysicsObject");
+	if (classname && strncmp(classname, "func_", 5) == 0)
+		flags |= ENTITY_BRUSH;
+
+	int index = GetEntityIndex(entity);
+
+	if (m_entityClass.IsValidIndex(index))
+		m_entityClass[index] = flags;
+
+	return flags;
+}
+
+void ResolveCollisionTools::FindEntityOffsets(CBaseEntity* entity)
+{
+	m_CBaseEntity_m_hOwnerEntity = GetDataOffset(entity, "m_hOwnerEntity");
+	m_CBaseEntity_m_CollisionGroup = GetDataOffset(entity, "m_CollisionGroup");
+	m_CBaseEntity_m_MoveType = GetDataOffset(entity, "m_MoveType");
+	m_CBaseEntity_m_ModelName = GetDataOffset(entity, "m_ModelName");
+	m_CBaseEntity_m_nSolidType = GetDataOffset(entity, "m_nSolidType");
+	m_CBaseEntity_m_usSolidFlags = GetDataOffset(entity, "m_usSolidFlags");
+	m_CBaseEntity_m_iHealth = GetDataOffset(entity, "m_iHealth");
+
+	Assert(m_CBaseEntity_m_hOwnerEntity != -1 && m_CBaseEntity_m_CollisionGroup != -1 && m_CBaseEntity_m_MoveType != -1);
+	Assert(m_CBaseEntity_m_ModelName != -1 && m_CBaseEntity_m_nSolidType != -1 && m_CBaseEntity_m_usSolidFlags != -1);
+	Assert(m_CBaseEntity_m_iHealth != -1);
+}
+
+bool ResolveCollisionTools::ShouldHitEntitySimple(const IHandleEntity* passentity, IHandleEntity* pHandleEntity, int contentsMask)
+{
+	Assert(contentsMask & CONTENTS_WINDOW);
+
+	if (pHandleEntity == passentity)
+		return false;
+
+	// StandardFilterRules lets static props through and they have no owner
+	if (IsStaticProp(pHandleEntity))
+		return true;
+
+	CBaseEntity* entity = reinterpret_cast<CBaseEntity*>(pHandleEntity);
+
+	if (m_CBaseEntity_m_CollisionGroup == -1)
+		FindEntityOffsets(entity);
+
+	auto field = [entity](int offset) -> uintptr_t
+		{
+			return (uintptr_t)entity + offset;
+		};
+
+	if (*reinterpret_cast<const unsigned short*>(field(m_CBaseEntity_m_usSolidFlags)) & FSOLID_NOT_SOLID)
+		return false;
+
+	// StandardFilterRules, only brush models that are solid BSP/VPhysics aren't monsters
+	if ((contentsMask & CONTENTS_MONSTER) == 0)
+	{
+		const char* model = *reinterpret_cast<const char* const*>(field(m_CBaseEntity_m_ModelName));
+		const unsigned char solid = *reinterpret_cast<const unsigned char*>(field(m_CBaseEntity_m_nSolidType));
+
+		if (model == nullptr || model[0] != '*' || (solid != SOLID_BSP && solid != SOLID_VPHYSICS))
+			return false;
+	}
+
+	if ((contentsMask & CONTENTS_MOVEABLE) == 0 && *reinterpret_cast<const unsigned char*>(field(m_CBaseEntity_m_MoveType)) == MOVETYPE_PUSH)
+		return false;
+
+	// PassServerEntityFilter
+	if (passentity && !IsStaticProp(passentity))
+	{
+		const CBaseHandle& owner = *reinterpret_cast<const CBaseHandle*>(field(m_CBaseEntity_m_hOwnerEntity));
+
+		if (owner == passentity->GetRefEHandle())
+			return false;
+
+		const CBaseHandle& passOwner = *reinterpret_cast<const CBaseHandle*>((uintptr_t)passentity + m_CBaseEntity_m_hOwnerEntity);
+
+		if (passOwner == pHandleEntity->GetRefEHandle())
+			return false;
+	}
+
+	const int collisionGroup = *reinterpret_cast<const int*>(field(m_CBaseEntity_m_CollisionGroup));
+
+	// CBaseEntity::ShouldCollide
+	if (collisionGroup == COLLISION_GROUP_DEBRIS && (contentsMask & CONTENTS_DEBRIS) == 0)
+		return false;
+
+	// CGameRules::ShouldCollide against COLLISION_GROUP_NONE
+	if (collisionGroup == COLLISION_GROUP_IN_VEHICLE || collisionGroup == COLLISION_GROUP_DOOR_BLOCKER)
+		return false;
+
+	return true;
+}
+
+float ResolveCollisionTools::CBaseEntity_GetBoundingRadius(CBaseEntity* entity)
+{
+	if (m_CBaseEntity_m_vecMins == -1)
+	{
+		m_CBaseEntity_m_vecMins = GetDataOffset(entity, "m_vecMins");
+		m_CBaseEntity_m_vecMaxs = GetDataOffset(entity, "m_vecMaxs");
+		Assert(m_CBaseEntity_m_vecMins != -1 && m_CBaseEntity_m_vecMaxs != -1);
+	}
+
+	// collision bounds are in entity space, the farther corner bounds any rotation
+	const Vector& mins = *reinterpret_cast<const Vector*>((uintptr_t)entity + m_CBaseEntity_m_vecMins);
+	const Vector& maxs = *reinterpret_cast<const Vector*>((uintptr_t)entity + m_CBaseEntity_m_vecMaxs);
+
+	return MAX(mins.Length(), maxs.Length());
+}
+
+// https://github.com/asherkin/vphysics/blob/d5e0287bb11b3a06dd727e66a9f3442e693dcf58/extension/physnatives.cpp#L1034-L1055
+IPhysicsObject* ResolveCollisionTools::GetPhysicsObject(CBaseEntity* pEntity)
+{
+	// m_pPhysicsObject belongs to CBaseEntity, so its offset is the same for every class
+	if (m_CBaseEntity_m_pPhysicsObject == -1)
+		m_CBaseEntity_m_pPhysicsObject = GetDataOffset(pEntity, "m_pPhysicsObject");
 
-	if (!type)
+	if (m_CBaseEntity_m_pPhysicsObject == -1)
 	{
 		return NULL;
 	}
 
-#if SOURCE_ENGINE >= SE_LEFT4DEAD
-	return *(IPhysicsObject**)((char*)pEntity + type->fieldOffset);
-#else
-	return *(IPhysicsObject**)((char*)pEntity + type->fieldOffset[TD_OFFSET_NORMAL]);
-#endif
+	return *(IPhysicsObject**)((char*)pEntity + m_CBaseEntity_m_pPhysicsObject);
 }
 
 CBaseEntity* ResolveCollisionTools::BaseHandleToBaseEntity(const CBaseHandle& handle)
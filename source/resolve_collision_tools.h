@@ -3,6 +3,8 @@
 
 #include <utlvector.h>
 #include <ehandle.h>
+#include <ihandleentity.h>
+#include "entity_slots.h"
 
 namespace ine
 {
@@ -56,8 +58,28 @@ class Vector;
 template< class T >
 class CHandle;
 
+#ifndef STATICPROP_EHANDLE_MASK
+#define STATICPROP_EHANDLE_MASK 0x40000000
+#endif
+
 extern bool ClassMatchesComplex(CBaseEntity* entity, const char* match);
 
+// Classification bits cached per entity index when the entity is created
+enum EntityClassFlags
+{
+	ENTITY_CLASSIFIED			= (1 << 0),		// slot holds a valid classification
+	ENTITY_INFECTED				= (1 << 1),		// MyInfectedPointer
+	ENTITY_PLAYER				= (1 << 2),		// IsPlayer
+	ENTITY_NEXTBOT				= (1 << 3),		// MyNextBotPointer
+	ENTITY_COMBAT_CHARACTER		= (1 << 4),		// MyCombatCharacterPointer
+	ENTITY_PHYSICS_PROP			= (1 << 5),		// CPhysicsProp
+	ENTITY_PROP_DOOR			= (1 << 6),		// CBasePropDoor
+	ENTITY_BREAKABLE			= (1 << 7),		// func_breakable, func_breakable_surf or CBreakableProp
+	ENTITY_BRUSH				= (1 << 8),		// func_* brush entity
+
+	ENTITY_MOVER				= ENTITY_PHYSICS_PROP | ENTITY_PROP_DOOR | ENTITY_BREAKABLE | ENTITY_BRUSH,
+};
+
 class ResolveCollisionTools
 {
 	friend class SDKResolveCollision;
@@ -69,8 +91,30 @@ public:
 	int GetDataOffset(CBaseEntity* entity, const char* name);
 	int GetDataOffset(const char* netclass, const char* property);
 
+	inline int GetEntityIndex(CBaseEntity* entity);
+
+	int ClassifyEntity(CBaseEntity* entity, const char* classname = nullptr);
+	inline int GetEntityClass(CBaseEntity* entity);
+
+	inline bool IsInfected(CBaseEntity* entity) { return (GetEntityClass(entity) & ENTITY_INFECTED) != 0; }
+	inline bool IsPlayer(CBaseEntity* entity) { return (GetEntityClass(entity) & ENTITY_PLAYER) != 0; }
+	inline bool IsNextBot(CBaseEntity* entity) { return (GetEntityClass(entity) & ENTITY_NEXTBOT) != 0; }
+	inline bool IsCombatCharacter(CBaseEntity* entity) { return (GetEntityClass(entity) & ENTITY_COMBAT_CHARACTER) != 0; }
+	inline bool IsPhysicsProp(CBaseEntity* entity) { return (GetEntityClass(entity) & ENTITY_PHYSICS_PROP) != 0; }
+	inline bool IsPropDoor(CBaseEntity* entity) { return (GetEntityClass(entity) & ENTITY_PROP_DOOR) != 0; }
+	inline bool IsBreakableClass(CBaseEntity* entity) { return (GetEntityClass(entity) & ENTITY_BREAKABLE) != 0; }
+
 	inline bool CTraceFilterSimple_ShouldHitEntity(ITraceFilter* trace, IHandleEntity* pHandleEntity, int contentsMask);
 	inline bool ZombieBotCollisionTraceFilter_ShouldHitEntity(ITraceFilter* trace, IHandleEntity* pHandleEntity, int contentsMask);
+
+	// CTraceFilterSimple::ShouldHitEntity for COLLISION_GROUP_NONE read from entity memory, mask must include CONTENTS_WINDOW
+	bool ShouldHitEntitySimple(const IHandleEntity* passentity, IHandleEntity* pHandleEntity, int contentsMask);
+	inline bool IsStaticProp(const IHandleEntity* pHandleEntity);
+	inline bool CTerrorPlayer_IsGhost(CBaseEntity* player);
+
+	inline int CBaseEntity_GetHealth(CBaseEntity* entity);
+	inline int CBaseEntity_GetCollisionGroup(CBaseEntity* entity);
+	inline unsigned short CBaseEntity_GetSolidFlags(CBaseEntity* entity);
 	
 	inline CBaseEntity* MyCombatCharacterPointer(CBaseEntity* entity);
 	inline INextBot* MyNextBotPointer(CBaseEntity* entity);
@@ -84,6 +128,8 @@ public:
 
 	inline const Vector& CBaseEntity_GetAbsOrigin(CBaseEntity* entity);
 	inline const Vector& CBaseEntity_GetAbsVelocity(CBaseEntity* entity);
+	inline const QAngle& CBaseEntity_GetAbsAngles(CBaseEntity* entity);
+	float CBaseEntity_GetBoundingRadius(CBaseEntity* entity);
 	CBaseEntity* CBaseEntity_GetGroundEntity(CBaseEntity* entity);
 
 	inline CUtlVector< CHandle< CBaseEntity > >& Infected_GetNeighbors(CBaseEntity* infected);
@@ -98,6 +144,7 @@ public:
 
 protected:
 	bool Initialize(SourceMod::IGameConfig* config);
+	void FindEntityOffsets(CBaseEntity* entity);
 
 	void* m_CTraceFilterSimple_ShouldHitEntity;
 	void* m_ZombieBotCollisionTraceFilter_ShouldHitEntity;
@@ -116,9 +163,46 @@ protected:
 	
 	int m_CBaseEntity_m_vecAbsOrigin;
 	int m_CBaseEntity_m_vecAbsVelocity;
+	int m_CBaseEntity_m_angAbsRotation;
+	int m_CBaseEntity_m_vecMins;
+	int m_CBaseEntity_m_vecMaxs;
 	int m_CBaseEntity_m_hGroundEntity;
+	int m_CBaseEntity_m_hOwnerEntity;
+	int m_CBaseEntity_m_CollisionGroup;
+	int m_CBaseEntity_m_MoveType;
+	int m_CBaseEntity_m_ModelName;
+	int m_CBaseEntity_m_nSolidType;
+	int m_CBaseEntity_m_usSolidFlags;
+	int m_CBaseEntity_m_iHealth;
+	int m_CBaseEntity_m_pPhysicsObject;
+	int m_CTerrorPlayer_m_isGhost;
+
+	CEntitySlotStorage<uint16_t, NUM_ENT_ENTRIES> m_entityClass;
 };
 
+inline int ResolveCollisionTools::GetEntityIndex(CBaseEntity* entity)
+{
+	return reinterpret_cast<IHandleEntity*>(entity)->GetRefEHandle().GetEntryIndex();
+}
+
+inline int ResolveCollisionTools::GetEntityClass(CBaseEntity* entity)
+{
+	if (entity == nullptr)
+		return 0;
+
+	int index = GetEntityIndex(entity);
+
+	if (!m_entityClass.IsValidIndex(index))
+		return ClassifyEntity(entity);
+
+	// Entities that existed before we were loaded are classified on first use
+	int flags = m_entityClass[index];
+	if ((flags & ENTITY_CLASSIFIED) == 0)
+		flags = ClassifyEntity(entity);
+
+	return flags;
+}
+
 inline bool ResolveCollisionTools::CTraceFilterSimple_ShouldHitEntity(ITraceFilter* trace, IHandleEntity* pHandleEntity, int contentsMask)
 {
 	return ine::call_this<bool>(m_CTraceFilterSimple_ShouldHitEntity, trace, pHandleEntity, contentsMask);
@@ -191,6 +275,58 @@ inline const Vector& ResolveCollisionTools::CBaseEntity_GetAbsVelocity(CBaseEnti
 	return *reinterpret_cast<const Vector*>((int)(entity) + m_CBaseEntity_m_vecAbsVelocity);
 }
 
+inline bool ResolveCollisionTools::IsStaticProp(const IHandleEntity* pHandleEntity)
+{
+	// same test as IStaticPropMgr::IsStaticProp, static props carry a reserved serial number
+	return pHandleEntity->GetRefEHandle().GetSerialNumber() == (STATICPROP_EHANDLE_MASK >> NUM_ENT_ENTRY_BITS);
+}
+
+inline bool ResolveCollisionTools::CTerrorPlayer_IsGhost(CBaseEntity* player)
+{
+	if (m_CTerrorPlayer_m_isGhost == -1)
+	{
+		m_CTerrorPlayer_m_isGhost = GetDataOffset("CTerrorPlayer", "m_isGhost");
+		Assert(m_CTerrorPlayer_m_isGhost != -1);
+	}
+
+	return *reinterpret_cast<const bool*>((int)(player) + m_CTerrorPlayer_m_isGhost);
+}
+
+inline int ResolveCollisionTools::CBaseEntity_GetHealth(CBaseEntity* entity)
+{
+	if (m_CBaseEntity_m_iHealth == -1)
+		FindEntityOffsets(entity);
+
+	return *reinterpret_cast<const int*>((int)(entity) + m_CBaseEntity_m_iHealth);
+}
+
+inline int ResolveCollisionTools::CBaseEntity_GetCollisionGroup(CBaseEntity* entity)
+{
+	if (m_CBaseEntity_m_CollisionGroup == -1)
+		FindEntityOffsets(entity);
+
+	return *reinterpret_cast<const int*>((int)(entity) + m_CBaseEntity_m_CollisionGroup);
+}
+
+inline unsigned short ResolveCollisionTools::CBaseEntity_GetSolidFlags(CBaseEntity* entity)
+{
+	if (m_CBaseEntity_m_usSolidFlags == -1)
+		FindEntityOffsets(entity);
+
+	return *reinterpret_cast<const unsigned short*>((int)(entity) + m_CBaseEntity_m_usSolidFlags);
+}
+
+inline const QAngle& ResolveCollisionTools::CBaseEntity_GetAbsAngles(CBaseEntity* entity)
+{
+	if (m_CBaseEntity_m_angAbsRotation == -1)
+	{
+		m_CBaseEntity_m_angAbsRotation = GetDataOffset(entity, "m_angAbsRotation");
+		Assert(m_CBaseEntity_m_angAbsRotation != -1);
+	}
+
+	return *reinterpret_cast<const QAngle*>((int)(entity) + m_CBaseEntity_m_angAbsRotation);
+}
+
 inline void ResolveCollisionTools::CBaseEntity_SetGroundEntity(CBaseEntity* entity, CBaseEntity* ground)
 {
 	ine::call_this<void>(m_CBaseEntity_SetGroundEntity, entity, ground);
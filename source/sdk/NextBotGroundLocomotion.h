@@ -11,6 +11,8 @@
 
 class CNavArea;
 class NextBotCombatCharacter;
+struct NextBotGroundCollisionData;
+struct NextBotGroundCollisionFeatures;
 
 enum NavRelativeDirType
 {
@@ -42,22 +44,38 @@ public:
 
 public:
 	Vector ResolveZombieCollisions( const Vector &pos );	// push away zombies that are interpenetrating
-	Vector ResolveCollision( const Vector &from, const Vector &to, int recursionLimit );	// check for collisions along move
+	Vector ResolveCollision( const Vector &from, const Vector &to, int recursionLimit );	// check for collisions along move, dispatches to the instantiation selected by the ConVars
+
+	template<bool Fix, bool Debug, bool MultiPlane>
+	Vector ResolveCollision( const Vector &from, const Vector &to, int recursionLimit );	// Fix - skip the "close enough" early outs of the original; Debug - draw overlays; MultiPlane - clip against every plane hit
+
+	template<bool Debug>
 	bool DetectCollision( trace_t *pTrace, int &nDestructionAllowed, const Vector &from, const Vector &to, const Vector &vecMins, const Vector &vecMaxs );						// return true if we are climbing a ladder
 	
 	void UpdatePosition(const Vector& newPos);
+	bool Depenetrate(const Vector& from, const Vector& mins, const Vector& maxs, const Vector& away, Vector& out);	// nearest spot out of solid along a horizontal axis, reachable from the last valid position
 
 
 	bool ClimbUpToLedgeThunk(const Vector& landingGoal, const Vector& landingForward, const CBaseEntity* obstacle);
+	bool SearchLedge(const Vector& landingGoal, const Vector& landingForward, const Vector& mins, const Vector& maxs, Vector& normal, Vector& landingGoalResolve);	// wall normal and landing spot by traces
+	bool IsLandingClear(const Vector& spot, float landingHeight);	// our hull rises from spot to landingHeight unobstructed
 	float GetTraversableSlopeLimitThunk();
 
 	void UpdateGroundConstraint(void);
+	bool ReuseGroundTrace(float halfWidth, float hullHeight, float stickToGroundTolerance, trace_t* ground);	// last world ground if nothing changed under us
+	bool HeightfieldGroundTrace(float halfWidth, float hullHeight, float stickToGroundTolerance, unsigned int mask, trace_t* ground);	// ground from the world heightfield
+	bool PlaneGroundTrace(const Vector& normal, float dist, float halfWidth, float stickToGroundTolerance, trace_t* ground);	// ground trace result of resting on a world plane
+	bool UpdateSleep(void);			// true while we rest and collision and ground work can be skipped
+	void WakeUp(void);
 	bool DidJustJump(void) const;
 
 	float GetGravity() const;
 
 	bool HasClimbingActivity();
 
+	NextBotGroundCollisionData& GetCollisionData();		// extension-side state stored in the slot of our entity index
+	NextBotGroundCollisionFeatures& GetCollisionFeatures();	// the same for optional features, apart from the per-update state
+
 public:
 	Vector m_goal;
 	Vector m_velocity;
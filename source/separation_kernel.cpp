@@ -0,0 +1,184 @@
+#include "separation_kernel.h"
+
+#include <math.h>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define SEPARATION_KERNEL_AVX
+#elif defined(__SSE__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1) || defined(_M_X64)
+#include <xmmintrin.h>
+#define SEPARATION_KERNEL_SSE
+#endif
+
+// smallest squared range we normalize by, coincident infected get a zero direction like VectorNormalize gives
+static constexpr float SEPARATION_MIN_RANGE_SQR = 1e-12f;
+
+static inline void SeparationScalar(float x, float y, float hullWidth, float cx, float cy, float& dirX, float& dirY, float& weight, SeparationResult& result)
+{
+	const float dx = cx - x;
+	const float dy = cy - y;
+	const float rangeSqr = dx * dx + dy * dy;
+	const float range = sqrtf(rangeSqr);
+	const float inverse = 1.0f / sqrtf(rangeSqr > SEPARATION_MIN_RANGE_SQR ? rangeSqr : SEPARATION_MIN_RANGE_SQR);
+
+	dirX = dx * inverse;
+	dirY = dy * inverse;
+	weight = 0.0f;
+
+	if (range < hullWidth)
+	{
+		weight = 1.0f + (2.0f * (hullWidth - range) / hullWidth);
+
+		result.avoidX -= weight * dirX;
+		result.avoidY -= weight * dirY;
+		result.avoidWeight += weight;
+		result.contacts++;
+	}
+}
+
+static inline int CountBits(int mask)
+{
+	int count = 0;
+
+	for (; mask; mask &= mask - 1)
+		count++;
+
+	return count;
+}
+
+void SeparationKernel(float x, float y, float hullWidth, const float* candX, const float* candY, int count,
+	float* dirX, float* dirY, float* weight, SeparationResult& result)
+{
+	result.avoidX = 0.0f;
+	result.avoidY = 0.0f;
+	result.avoidWeight = 0.0f;
+	result.contacts = 0;
+
+	int i = 0;
+
+#if defined(SEPARATION_KERNEL_AVX)
+	{
+		const __m256 px = _mm256_set1_ps(x);
+		const __m256 py = _mm256_set1_ps(y);
+		const __m256 hull = _mm256_set1_ps(hullWidth);
+		const __m256 twoOverHull = _mm256_set1_ps(2.0f / hullWidth);
+		const __m256 one = _mm256_set1_ps(1.0f);
+		const __m256 half = _mm256_set1_ps(0.5f);
+		const __m256 threeHalves = _mm256_set1_ps(1.5f);
+		const __m256 minRangeSqr = _mm256_set1_ps(SEPARATION_MIN_RANGE_SQR);
+
+		__m256 sumX = _mm256_setzero_ps();
+		__m256 sumY = _mm256_setzero_ps();
+		__m256 sumW = _mm256_setzero_ps();
+
+		for (; i + 8 <= count; i += 8)
+		{
+			__m256 dx = _mm256_sub_ps(_mm256_loadu_ps(candX + i), px);
+			__m256 dy = _mm256_sub_ps(_mm256_loadu_ps(candY + i), py);
+			__m256 rangeSqr = _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy));
+			__m256 clamped = _mm256_max_ps(rangeSqr, minRangeSqr);
+
+			// decided on the exact range, the estimate lands just under hullWidth at exact contact
+			__m256 contact = _mm256_cmp_ps(_mm256_sqrt_ps(rangeSqr), hull, _CMP_LT_OQ);
+
+			// rsqrt estimate refined with one Newton-Raphson step
+			__m256 inverse = _mm256_rsqrt_ps(clamped);
+			inverse = _mm256_mul_ps(inverse, _mm256_sub_ps(threeHalves, _mm256_mul_ps(_mm256_mul_ps(half, clamped), _mm256_mul_ps(inverse, inverse))));
+
+			__m256 range = _mm256_mul_ps(rangeSqr, inverse);
+			__m256 nx = _mm256_mul_ps(dx, inverse);
+			__m256 ny = _mm256_mul_ps(dy, inverse);
+
+			__m256 w = _mm256_add_ps(one, _mm256_mul_ps(_mm256_sub_ps(hull, range), twoOverHull));
+			w = _mm256_and_ps(w, contact);
+
+			_mm256_storeu_ps(dirX + i, nx);
+			_mm256_storeu_ps(dirY + i, ny);
+			_mm256_storeu_ps(weight + i, w);
+
+			sumX = _mm256_sub_ps(sumX, _mm256_mul_ps(w, nx));
+			sumY = _mm256_sub_ps(sumY, _mm256_mul_ps(w, ny));
+			sumW = _mm256_add_ps(sumW, w);
+
+			result.contacts += CountBits(_mm256_movemask_ps(contact));
+		}
+
+		alignas(32) float lanes[8];
+
+		_mm256_store_ps(lanes, sumX);
+		for (int lane = 0; lane < 8; lane++)
+			result.avoidX += lanes[lane];
+
+		_mm256_store_ps(lanes, sumY);
+		for (int lane = 0; lane < 8; lane++)
+			result.avoidY += lanes[lane];
+
+		_mm256_store_ps(lanes, sumW);
+		for (int lane = 0; lane < 8; lane++)
+			result.avoidWeight += lanes[lane];
+	}
+#elif defined(SEPARATION_KERNEL_SSE)
+	{
+		const __m128 px = _mm_set1_ps(x);
+		const __m128 py = _mm_set1_ps(y);
+		const __m128 hull = _mm_set1_ps(hullWidth);
+		const __m128 twoOverHull = _mm_set1_ps(2.0f / hullWidth);
+		const __m128 one = _mm_set1_ps(1.0f);
+		const __m128 half = _mm_set1_ps(0.5f);
+		const __m128 threeHalves = _mm_set1_ps(1.5f);
+		const __m128 minRangeSqr = _mm_set1_ps(SEPARATION_MIN_RANGE_SQR);
+
+		__m128 sumX = _mm_setzero_ps();
+		__m128 sumY = _mm_setzero_ps();
+		__m128 sumW = _mm_setzero_ps();
+
+		for (; i + 4 <= count; i += 4)
+		{
+			__m128 dx = _mm_sub_ps(_mm_loadu_ps(candX + i), px);
+			__m128 dy = _mm_sub_ps(_mm_loadu_ps(candY + i), py);
+			__m128 rangeSqr = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+			__m128 clamped = _mm_max_ps(rangeSqr, minRangeSqr);
+
+			// decided on the exact range, the estimate lands just under hullWidth at exact contact
+			__m128 contact = _mm_cmplt_ps(_mm_sqrt_ps(rangeSqr), hull);
+
+			// rsqrt estimate refined with one Newton-Raphson step
+			__m128 inverse = _mm_rsqrt_ps(clamped);
+			inverse = _mm_mul_ps(inverse, _mm_sub_ps(threeHalves, _mm_mul_ps(_mm_mul_ps(half, clamped), _mm_mul_ps(inverse, inverse))));
+
+			__m128 range = _mm_mul_ps(rangeSqr, inverse);
+			__m128 nx = _mm_mul_ps(dx, inverse);
+			__m128 ny = _mm_mul_ps(dy, inverse);
+
+			__m128 w = _mm_add_ps(one, _mm_mul_ps(_mm_sub_ps(hull, range), twoOverHull));
+			w = _mm_and_ps(w, contact);
+
+			_mm_storeu_ps(dirX + i, nx);
+			_mm_storeu_ps(dirY + i, ny);
+			_mm_storeu_ps(weight + i, w);
+
+			sumX = _mm_sub_ps(sumX, _mm_mul_ps(w, nx));
+			sumY = _mm_sub_ps(sumY, _mm_mul_ps(w, ny));
+			sumW = _mm_add_ps(sumW, w);
+
+			result.contacts += CountBits(_mm_movemask_ps(contact));
+		}
+
+		alignas(16) float lanes[4];
+
+		_mm_store_ps(lanes, sumX);
+		result.avoidX += lanes[0] + lanes[1] + lanes[2] + lanes[3];
+
+		_mm_store_ps(lanes, sumY);
+		result.avoidY += lanes[0] + lanes[1] + lanes[2] + lanes[3];
+
+		_mm_store_ps(lanes, sumW);
+		result.avoidWeight += lanes[0] + lanes[1] + lanes[2] + lanes[3];
+	}
+#endif
+
+	for (; i < count; i++)
+	{
+		SeparationScalar(x, y, hullWidth, candX[i], candY[i], dirX[i], dirY[i], weight[i], result);
+	}
+}
@@ -0,0 +1,21 @@
+#ifndef _INCLUDE_SEPARATION_KERNEL_H
+#define _INCLUDE_SEPARATION_KERNEL_H
+
+struct SeparationResult
+{
+	float avoidX;
+	float avoidY;
+	float avoidWeight;
+	int contacts;
+};
+
+/**
+ * Push of one infected standing at (x, y) against count candidates given as structure of arrays.
+ * For every candidate writes the XY unit direction towards it and its push weight, 0 when not in contact,
+ * and returns the sums in result. Uses rsqrt with one Newton step on SSE/AVX and plain math otherwise, contact is
+ * always decided on the exact range so every path agrees with the scalar compare.
+ */
+void SeparationKernel(float x, float y, float hullWidth, const float* candX, const float* candY, int count,
+	float* dirX, float* dirY, float* weight, SeparationResult& result);
+
+#endif // !_INCLUDE_SEPARATION_KERNEL_H
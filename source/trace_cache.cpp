@@ -0,0 +1,108 @@
+#include "extension.h"
+#include "trace_cache.h"
+
+#include <string.h>
+
+TraceCache g_traceCache;
+TraceCache* tracecache = &g_traceCache;
+
+TraceCache::TraceCache() :
+	m_frame(0),
+	m_stats()
+{
+	Clear();
+}
+
+void TraceCache::Clear()
+{
+	for (int i = 0; i < CAPACITY; i++)
+		m_slots[i].frame = -1;
+}
+
+uint32_t TraceCache::HashKey(const Key& key)
+{
+	// FNV-1a over the key words
+	const uint32_t* words = reinterpret_cast<const uint32_t*>(&key);
+	uint32_t hash = 2166136261u;
+
+	for (size_t i = 0; i < sizeof(Key) / sizeof(uint32_t); i++)
+	{
+		hash ^= words[i];
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+void TraceCache::TraceHull(const Vector& start, const Vector& end, const Vector& mins, const Vector& maxs, unsigned int mask, TraceCacheFilter kind, ITraceFilter* filter, trace_t* trace)
+{
+	Ray_t ray;
+	ray.Init(start, end, mins, maxs);
+
+	if (!g_settings.trace_cache)
+	{
+		enginetrace->TraceRay(ray, mask, filter, trace);
+		return;
+	}
+
+	Key key;
+
+	for (int i = 0; i < 3; i++)
+	{
+		key.start[i] = Quantize(start[i]);
+		key.end[i] = Quantize(end[i]);
+		key.mins[i] = Quantize(mins[i]);
+		key.maxs[i] = Quantize(maxs[i]);
+	}
+
+	key.mask = mask;
+	key.kind = kind;
+
+	Slot& slot = m_slots[HashKey(key) & (CAPACITY - 1)];
+
+	m_stats.lookups++;
+
+	if (slot.frame == m_frame && memcmp(&slot.key, &key, sizeof(Key)) == 0 && Reuse(slot.trace, start, end, mins, maxs, trace))
+	{
+		m_stats.hits++;
+		return;
+	}
+
+	enginetrace->TraceRay(ray, mask, filter, trace);
+
+	slot.key = key;
+	slot.frame = m_frame;
+	slot.trace = *trace;
+}
+
+bool TraceCache::Reuse(const trace_t& cached, const Vector& start, const Vector& end, const Vector& mins, const Vector& maxs, trace_t* trace)
+{
+	// the cached sweep may have started up to half a quantum away, whether ours starts solid too is unknown
+	if (cached.startsolid)
+		return false;
+
+	*trace = cached;
+	trace->startpos = start;
+
+	if (cached.fraction < 1.0f)
+	{
+		// find where our own box meets the cached plane, backed off like the engine does
+		const Vector& normal = cached.plane.normal;
+		float offset = -cached.plane.dist;
+
+		for (int i = 0; i < 3; i++)
+			offset += normal[i] * (normal[i] > 0.0f ? mins[i] : maxs[i]);
+
+		const float startDist = DotProduct(normal, start) + offset;
+		const float endDist = DotProduct(normal, end) + offset;
+
+		// our box is already touching or behind the plane, or never reaches it
+		if (startDist < HIT_BACKOFF || endDist >= startDist)
+			return false;
+
+		trace->fraction = MIN((startDist - HIT_BACKOFF) / (startDist - endDist), 1.0f);
+	}
+
+	trace->endpos = start + trace->fraction * (end - start);
+	return true;
+}
@@ -0,0 +1,82 @@
+#ifndef _INCLUDE_TRACE_CACHE_H
+#define _INCLUDE_TRACE_CACHE_H
+
+#include <mathlib/vector.h>
+#include <IEngineTrace.h>
+#include <gametrace.h>
+#include <stdint.h>
+
+// Filters whose result doesn't depend on the mover, so their traces can be shared between bots
+enum TraceCacheFilter
+{
+	TRACE_CACHE_WORLD_ONLY = 0,		// TRACE_WORLD_ONLY filters
+	TRACE_CACHE_IGNORE_ACTORS,		// NextBotTraceFilterIgnoreActors, COLLISION_GROUP_NONE
+};
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Direct-mapped cache of hull traces issued within the current frame.
+ * Start, end and extents are quantized, so the key only says the sweeps are close. A hit keeps the plane of the cached
+ * trace and recomputes the fraction for the caller's own start and end, sweeps that start solid are never shared.
+ * Only meant for sweeps where a miss within a quantum of the end doesn't matter, like the ground trace; collision sweeps
+ * must not go through it.
+ */
+class TraceCache
+{
+public:
+	static constexpr int CAPACITY_BITS = 10;
+	static constexpr int CAPACITY = 1 << CAPACITY_BITS;
+	static constexpr float QUANTUM = 0.25f;
+	static constexpr float HIT_BACKOFF = 0.03125f;	// same backoff from the hit plane as the engine's
+
+	struct Stats
+	{
+		int lookups;
+		int hits;
+	};
+
+	TraceCache();
+
+	void NewFrame() { m_frame++; }
+	void Clear();
+
+	// TraceHull through the cache when z_resolve_collision_trace_cache is on, kind must describe filter
+	void TraceHull(const Vector& start, const Vector& end, const Vector& mins, const Vector& maxs, unsigned int mask, TraceCacheFilter kind, ITraceFilter* filter, trace_t* trace);
+
+	const Stats& GetStats() const { return m_stats; }
+	void ResetStats() { m_stats = Stats(); }
+
+private:
+	struct Key
+	{
+		int start[3];
+		int end[3];
+		int mins[3];
+		int maxs[3];
+		unsigned int mask;
+		int kind;
+	};
+
+	struct Slot
+	{
+		Key key;
+		int frame;
+		trace_t trace;
+	};
+
+	static inline int Quantize(float value)
+	{
+		return (int)floorf(value * (1.0f / QUANTUM) + 0.5f);
+	}
+
+	static uint32_t HashKey(const Key& key);
+	static bool Reuse(const trace_t& cached, const Vector& start, const Vector& end, const Vector& mins, const Vector& maxs, trace_t* trace);
+
+	Slot m_slots[CAPACITY];
+	int m_frame;
+	Stats m_stats;
+};
+
+extern TraceCache* tracecache;
+
+#endif // !_INCLUDE_TRACE_CACHE_H
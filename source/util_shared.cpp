@@ -15,5 +15,13 @@ CTraceFilterSimple::CTraceFilterSimple(const IHandleEntity* passedict, int colli
 //-----------------------------------------------------------------------------
 bool CTraceFilterSimple::ShouldHitEntity(IHandleEntity* pHandleEntity, int contentsMask)
 {
+	if (g_settings.native_trace_filter && m_collisionGroup == COLLISION_GROUP_NONE && (contentsMask & CONTENTS_WINDOW))
+	{
+		if (!collisiontools->ShouldHitEntitySimple(m_pPassEnt, pHandleEntity, contentsMask))
+			return false;
+
+		return m_pExtraShouldHitCheckFunction == nullptr || m_pExtraShouldHitCheckFunction(pHandleEntity, contentsMask);
+	}
+
 	return collisiontools->CTraceFilterSimple_ShouldHitEntity(this, pHandleEntity, contentsMask);
 }
\ No newline at end of file
@@ -32,6 +32,7 @@ public:
 	virtual void SetCollisionGroup(int iCollisionGroup) { m_collisionGroup = iCollisionGroup; }
 
 	const IHandleEntity* GetPassEntity(void) { return m_pPassEnt; }
+	int GetCollisionGroup(void) const { return m_collisionGroup; }
 
 private:
 	const IHandleEntity* m_pPassEnt;